@@ -0,0 +1,99 @@
+#include "AsteroidRing.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static const float twoPi = 6.28318531f;
+
+//SplitMix64: a counter mixed by a 64 bit finalizer, fast and well distributed, its state is a plain integer so a stream
+//can start anywhere (here at the seed, the cell and the index of an asteroid) without generating what comes before it
+class SplitMix64 {
+public:
+	SplitMix64(uint64_t seed, uint64_t stream) : mState(mix(seed + mix(stream + 1))) {}
+
+	uint64_t next()
+	{
+		mState += 0x9E3779B97F4A7C15ull;
+		return mix(mState);
+	}
+
+	// uniform in [0, 1), 24 bits so that every value is exact in a float
+	float uniform() { return (float)(next() >> 40) * (1.0f / 16777216.0f); }
+
+	float uniform(float low, float high) { return low + (high - low) * uniform(); }
+
+private:
+	static uint64_t mix(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	uint64_t mState;
+};
+
+//share of the asteroids between the offsets a and b from the radius, in widths ([-1, 1] is the whole ring)
+static double profileShare(AsteroidRing::Profile profile, double a, double b) {
+	if (profile == AsteroidRing::GAUSSIAN) {
+		//normal of standard deviation 0.5 truncated to [-1, 1]: erf(x / (0.5 * sqrt(2)))
+		const double scale = 1.4142135623730951;
+		return (std::erf(b * scale) - std::erf(a * scale)) / (2.0 * std::erf(scale));
+	}
+	return (b - a) * 0.5;
+}
+
+AsteroidRing::Cell AsteroidRing::cell(const Parameters& parameters, unsigned int index) {
+	Cell cell;
+	cell.row = index / parameters.sectors;
+	cell.sector = index % parameters.sectors;
+	const float rowWidth = 2.0f * parameters.width / parameters.rows;
+	cell.innerRadius = parameters.radius - parameters.width + cell.row * rowWidth;
+	cell.outerRadius = cell.innerRadius + rowWidth;
+	cell.startAngle = twoPi * cell.sector / parameters.sectors;
+	cell.endAngle = twoPi * (cell.sector + 1) / parameters.sectors;
+	return cell;
+}
+
+unsigned int AsteroidRing::asteroidCount(const Parameters& parameters, unsigned int index) {
+	const unsigned int row = index / parameters.sectors;
+	const unsigned int sector = index % parameters.sectors;
+	const double a = -1.0 + 2.0 * row / parameters.rows, b = -1.0 + 2.0 * (row + 1) / parameters.rows;
+	const unsigned int rowCount = (unsigned int)std::floor(parameters.count * profileShare(parameters.profile, a, b) + 0.5);
+	//the remainder of the row goes one by one to its first sectors
+	return rowCount / parameters.sectors + (sector < rowCount % parameters.sectors ? 1 : 0);
+}
+
+void AsteroidRing::generateCell(const Parameters& parameters, unsigned int index, InstanceTransform* instances, OrbitingInstances::Spin* spins) {
+	const Cell area = cell(parameters, index);
+	const unsigned int count = asteroidCount(parameters, index);
+	for (unsigned int i = 0; i < count; i++) {
+		//a stream per asteroid: the draws below only depend on the seed, the cell and the index
+		SplitMix64 random(parameters.seed, (uint64_t)index << 32 | i);
+
+		// 1. translation: angle around the ring (radians) and distance to the center within the cell (the profile is
+		// followed by the counts of the rows, the rows are thin enough to be uniform inside), height
+		const float angle = random.uniform(area.startAngle, area.endAngle);
+		const float distance = random.uniform(area.innerRadius, area.outerRadius);
+		const float y = random.uniform(-1.0f, 1.0f) * parameters.thickness;
+		const glm::vec3 position = parameters.center + glm::vec3(std::sin(angle) * distance, y, std::cos(angle) * distance);
+
+		// 2. scale: between minScale and maxScale, skewed towards minScale by sizeExponent
+		const float scale = parameters.minScale + (parameters.maxScale - parameters.minScale) * std::pow(random.uniform(), parameters.sizeExponent);
+
+		// 3. rotation: uniformly distributed orientation (Shoemake's method)
+		const float u1 = random.uniform();
+		const float theta1 = random.uniform(0.0f, twoPi);
+		const float theta2 = random.uniform(0.0f, twoPi);
+		const float r1 = std::sqrt(1.0f - u1), r2 = std::sqrt(u1);
+		const glm::quat rotation(r2 * std::cos(theta2), r1 * std::sin(theta1), r1 * std::cos(theta1), r2 * std::sin(theta2));
+
+		instances[i] = InstanceTransform(position, scale, rotation);
+
+		// 4. tumble: a uniformly distributed axis (point on the unit sphere), up to maxSpinSpeed
+		const float axisY = random.uniform(-1.0f, 1.0f);
+		const float axisAngle = random.uniform(0.0f, twoPi);
+		const float axisRadius = std::sqrt(std::max(1.0f - axisY * axisY, 0.0f));
+		spins[i] = { glm::vec3(axisRadius * std::cos(axisAngle), axisY, axisRadius * std::sin(axisAngle)), random.uniform() * parameters.maxSpinSpeed };
+	}
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef ASTEROID_RING_H
+#define ASTEROID_RING_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "InstanceTransform.hpp"
+#include "OrbitingInstances.hpp"
+
+// Procedural asteroid ring: positions, scales, orientations and spins drawn from a seeded generator, so that the same
+// parameters always give the same field (reproducible benchmarks). The ring is split in cells, rows (radial) times sectors
+// (angular): a cell is generated on its own, in any order and on any thread, and every asteroid has its own random stream
+// derived from the seed, its cell and its index, so a cell is the same whenever and wherever it is generated
+class AsteroidRing {
+public:
+	// Radial distribution of the asteroids across the ring
+	enum Profile {
+		UNIFORM, // evenly spread over [radius - width, radius + width]
+		GAUSSIAN // denser at the radius, width is two standard deviations (truncated at width)
+	};
+
+	struct Parameters {
+		uint64_t seed = 2017;
+		unsigned int count = 10000; // asteroids in the whole ring: its density, for the given radius and width
+		glm::vec3 center = glm::vec3(0.0f); // the ring lies in the y plane of its center
+		float radius = 120.0f;
+		float width = 40.0f; // radial half width
+		float thickness = 12.0f; // vertical half thickness, uniform
+		Profile profile = UNIFORM;
+		float minScale = 0.05f;
+		float maxScale = 0.25f;
+		float sizeExponent = 1.0f; // scale = minScale + (maxScale - minScale) * u^sizeExponent: 1 uniform, more for fewer large asteroids
+		float maxSpinSpeed = 0.8f; // radians per second
+		unsigned int rows = 32; // cells across the width, at most OrbitingInstances::orbitBands (a row orbits as one band)
+		unsigned int sectors = 32; // cells around the ring
+	};
+
+	// Part of the ring between two radii and two angles (radians, around the y axis from +z towards +x)
+	struct Cell {
+		unsigned int row, sector;
+		float innerRadius, outerRadius;
+		float startAngle, endAngle;
+	};
+
+	static unsigned int cellCount(const Parameters& parameters) { return parameters.rows * parameters.sectors; }
+	static Cell cell(const Parameters& parameters, unsigned int index);
+
+	// Asteroids in a cell: the share of count of its row (following the profile) spread over the sectors
+	static unsigned int asteroidCount(const Parameters& parameters, unsigned int index);
+
+	// Writes the asteroidCount asteroids of a cell in instances and spins
+	static void generateCell(const Parameters& parameters, unsigned int index, InstanceTransform* instances, OrbitingInstances::Spin* spins);
+};
+
+#endif
@@ -0,0 +1,139 @@
+#include "AsteroidStreamer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+void AsteroidStreamer::create(const AsteroidRing::Parameters& ring, unsigned int budget, float referenceSpeed, float reach) {
+	mRing = ring;
+	mRing.rows = std::min(std::max(ring.rows, 1u), OrbitingInstances::orbitBands);
+	mRing.sectors = std::max(ring.sectors, 1u);
+	mBudget = budget;
+	mOrbits.setBands(mRing.center, mRing.radius, referenceSpeed, mRing.radius - mRing.width, mRing.radius + mRing.width, mRing.rows, mRing.maxSpinSpeed);
+	const float asteroidReach = mRing.maxScale * reach;
+	mBoundsRadius = glm::length(glm::vec2(mRing.radius + mRing.width, mRing.thickness)) + asteroidReach;
+
+	//bounding sphere of each cell at time 0: around the middle of the cell, out to its farthest corner (or the middle of its
+	//outer arc) at the top of the ring, plus the reach of the largest asteroid
+	const unsigned int cells = AsteroidRing::cellCount(mRing);
+	mCellCenters.resize(cells);
+	mCellRadii.resize(cells);
+	mCellCounts.resize(cells);
+	for (unsigned int i = 0; i < cells; i++) {
+		const AsteroidRing::Cell cell = AsteroidRing::cell(mRing, i);
+		const float middleAngle = 0.5f * (cell.startAngle + cell.endAngle);
+		const float middleRadius = 0.5f * (cell.innerRadius + cell.outerRadius);
+		const glm::vec2 center = glm::vec2(std::sin(middleAngle), std::cos(middleAngle)) * middleRadius;
+		const glm::vec2 points[5] = {
+			glm::vec2(std::sin(cell.startAngle), std::cos(cell.startAngle)) * cell.innerRadius,
+			glm::vec2(std::sin(cell.startAngle), std::cos(cell.startAngle)) * cell.outerRadius,
+			glm::vec2(std::sin(cell.endAngle), std::cos(cell.endAngle)) * cell.innerRadius,
+			glm::vec2(std::sin(cell.endAngle), std::cos(cell.endAngle)) * cell.outerRadius,
+			glm::vec2(std::sin(middleAngle), std::cos(middleAngle)) * cell.outerRadius };
+		float extent = 0.0f;
+		for (const glm::vec2& point : points)
+			extent = std::max(extent, glm::length(point - center));
+		mCellCenters[i] = mRing.center + glm::vec3(center.x, 0.0f, center.y);
+		mCellRadii[i] = glm::length(glm::vec2(extent, mRing.thickness)) + asteroidReach;
+		mCellCounts[i] = AsteroidRing::asteroidCount(mRing, i);
+	}
+	mStates.assign(cells, UNLOADED);
+	mDistances.assign(cells, 0.0f);
+	mWanted.assign(cells, false);
+	mOrder.resize(cells);
+	mResident.clear();
+	mPending.clear();
+}
+
+float AsteroidStreamer::cellDistance(unsigned int cell, const glm::vec3& viewPos, double time) const {
+	const glm::vec3 center = mOrbits.orbitPosition(mCellCenters[cell], cell / mRing.sectors, time);
+	return std::max(glm::length(center - viewPos) - mCellRadii[cell], 0.0f);
+}
+
+bool AsteroidStreamer::update(const glm::vec3& viewPos, double time, ThreadPool& pool) {
+	const unsigned int cells = (unsigned int)mStates.size();
+	bool changed = false;
+
+	//the nearest cells, until one does not fit in the budget
+	for (unsigned int i = 0; i < cells; i++) {
+		mDistances[i] = cellDistance(i, viewPos, time);
+		mOrder[i] = i;
+	}
+	std::sort(mOrder.begin(), mOrder.end(), [this](unsigned int a, unsigned int b) { return mDistances[a] < mDistances[b]; });
+	mWanted.assign(cells, false);
+	unsigned int wantedCount = 0;
+	for (unsigned int cell : mOrder) {
+		if (wantedCount + mCellCounts[cell] > mBudget)
+			break;
+		wantedCount += mCellCounts[cell];
+		mWanted[cell] = true;
+	}
+
+	//generated cells: the ones still wanted replace the farthest unwanted resident cells (kept until their room is needed)
+	unsigned int added = 0;
+	for (unsigned int i = 0; i < mPending.size() && added < maxAddedAsteroids;) {
+		if (mPending[i].wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+			i++;
+			continue;
+		}
+		GeneratedCell generated = mPending[i].get();
+		mPending.erase(mPending.begin() + i);
+		mStates[generated.cell] = UNLOADED;
+		if (!mWanted[generated.cell])
+			continue;
+		const unsigned int count = (unsigned int)generated.instances.size();
+		while (residentCount() + count > mBudget) {
+			int farthest = -1;
+			for (unsigned int r = 0; r < mResident.size(); r++) {
+				const unsigned int cell = mResident[r].cell;
+				if (!mWanted[cell] && (farthest < 0 || mDistances[cell] > mDistances[mResident[farthest].cell]))
+					farthest = (int)r;
+			}
+			if (farthest < 0)
+				break;
+			evict(farthest);
+		}
+		if (residentCount() + count > mBudget)
+			continue;
+		const unsigned int first = mOrbits.append(generated.instances.data(), generated.spins.data(), count, generated.cell / mRing.sectors);
+		mResident.push_back({ generated.cell, first, count });
+		mStates[generated.cell] = RESIDENT;
+		added += count;
+		changed = true;
+	}
+
+	//missing cells, nearest first, generated on the pool
+	unsigned int pendingCount = 0;
+	for (unsigned int cell = 0; cell < cells; cell++)
+		if (mStates[cell] == PENDING)
+			pendingCount += mCellCounts[cell];
+	for (unsigned int cell : mOrder) {
+		if (!mWanted[cell] || pendingCount >= maxPendingAsteroids)
+			break;
+		if (mStates[cell] != UNLOADED)
+			continue;
+		mStates[cell] = PENDING;
+		pendingCount += mCellCounts[cell];
+		const AsteroidRing::Parameters ring = mRing;
+		const unsigned int count = mCellCounts[cell];
+		mPending.push_back(pool.submit([ring, cell, count]() {
+			GeneratedCell generated;
+			generated.cell = cell;
+			generated.instances.resize(count);
+			generated.spins.resize(count);
+			AsteroidRing::generateCell(ring, cell, generated.instances.data(), generated.spins.data());
+			return generated;
+		}));
+	}
+	return changed;
+}
+
+void AsteroidStreamer::evict(unsigned int index) {
+	const ResidentCell removed = mResident[index];
+	mOrbits.erase(removed.first, removed.count);
+	mResident.erase(mResident.begin() + index);
+	for (ResidentCell& resident : mResident)
+		if (resident.first > removed.first)
+			resident.first -= removed.count;
+	mStates[removed.cell] = UNLOADED;
+}
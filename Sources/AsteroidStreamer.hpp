@@ -0,0 +1,78 @@
+#pragma once
+
+#ifndef ASTEROID_STREAMER_H
+#define ASTEROID_STREAMER_H
+
+#include <future>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "AsteroidRing.hpp"
+#include "InstanceTransform.hpp"
+#include "OrbitingInstances.hpp"
+#include "ThreadPool.hpp"
+
+// Streaming of the cells of an asteroid ring around the camera: only the nearest cells that fit in a budget of asteroids are
+// resident, so the memory (the orbits here, the instance buffers of the culling) stays flat whatever the count of the ring.
+// Missing cells are generated on a thread pool and added once ready, a few per frame; the farthest cells make room for them.
+// Each row of cells orbits as one band, so a cell keeps its shape and its bounds are known at any time without its asteroids
+class AsteroidStreamer {
+public:
+	// ring: the whole field; budget: most resident asteroids; referenceSpeed: orbit speed (radians per second) at the radius of
+	// the ring; reach: distance from the position of an asteroid of scale 1 to the farthest point of its model
+	void create(const AsteroidRing::Parameters& ring, unsigned int budget, float referenceSpeed, float reach);
+
+	// Picks the cells to keep around viewPos at time (seconds), queues the missing ones on pool and adds those generated
+	// since the last update. Returns true when the resident asteroids changed
+	bool update(const glm::vec3& viewPos, double time, ThreadPool& pool);
+
+	// Orbits of the resident asteroids, OrbitingInstances::update writes their transforms
+	const OrbitingInstances& orbits() const { return mOrbits; }
+	unsigned int residentCount() const { return mOrbits.instanceCount(); }
+	unsigned int residentCells() const { return (unsigned int)mResident.size(); }
+	unsigned int budget() const { return mBudget; }
+
+	// Bounding sphere of the whole ring, whichever cells are resident
+	glm::vec3 boundsCenter() const { return mRing.center; }
+	float boundsRadius() const { return mBoundsRadius; }
+
+private:
+	static const unsigned int maxPendingAsteroids = 65536; // in the cells being generated, more cells wait for the next updates
+	static const unsigned int maxAddedAsteroids = 32768; // copied in the orbits per update (at least one cell)
+
+	struct GeneratedCell {
+		unsigned int cell;
+		std::vector<InstanceTransform> instances;
+		std::vector<OrbitingInstances::Spin> spins;
+	};
+
+	struct ResidentCell {
+		unsigned int cell;
+		unsigned int first; // in the orbits
+		unsigned int count;
+	};
+
+	enum CellState : unsigned char { UNLOADED, PENDING, RESIDENT };
+
+	// distance at time from viewPos to the bounding sphere of a cell (0 inside)
+	float cellDistance(unsigned int cell, const glm::vec3& viewPos, double time) const;
+	// removes the resident cell at index, the next ones move down in the orbits
+	void evict(unsigned int index);
+
+	AsteroidRing::Parameters mRing;
+	unsigned int mBudget = 0;
+	float mBoundsRadius = 0.0f;
+	OrbitingInstances mOrbits;
+	std::vector<glm::vec3> mCellCenters; // at time 0
+	std::vector<float> mCellRadii;
+	std::vector<unsigned int> mCellCounts;
+	std::vector<CellState> mStates;
+	std::vector<float> mDistances; // of the last update
+	std::vector<unsigned int> mOrder; // cells by distance, scratch of update
+	std::vector<bool> mWanted; // nearest cells fitting the budget, of the last update
+	std::vector<ResidentCell> mResident;
+	std::vector<std::future<GeneratedCell>> mPending;
+};
+
+#endif
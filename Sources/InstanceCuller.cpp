@@ -0,0 +1,287 @@
+#include "InstanceCuller.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#include <xmmintrin.h>
+#define INSTANCE_CULLER_SSE
+#endif
+
+static const unsigned char culled = 0xFF; //level of the instances outside the frustum
+
+//planes of the clip space frustum of a matrix (Gribb-Hartmann), normals pointing inside
+static void frustumPlanes(const glm::mat4& m, glm::vec4* planes) {
+	const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+	const glm::vec4 unnormalized[6] = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+	for (unsigned int i = 0; i < 6; i++)
+		planes[i] = unnormalized[i] / glm::length(glm::vec3(unnormalized[i]));
+}
+
+void InstanceCuller::create(const std::vector<Mesh>& meshes, const glm::vec3& boundsCenter, float boundsRadius, const std::vector<float>& lodErrors,
+	const std::vector<InstanceTransform>& instances, Shader cullShader, bool gpu, unsigned int capacity) {
+	mGpu = gpu && GLAD_GL_VERSION_4_4; //query results written in a buffer: 4.4, indirect draws: 4.0
+	mMeshCount = (unsigned int)meshes.size();
+	mBoundsCenter = boundsCenter;
+	mBoundsRadius = boundsRadius;
+	mLodCount = std::min((unsigned int)std::max<size_t>(lodErrors.size(), 1), maxLods);
+	for (unsigned int lod = 0; lod < maxLods; lod++)
+		mLodErrors[lod] = lod < lodErrors.size() ? lodErrors[lod] : 0.0f;
+	mCount = (unsigned int)instances.size();
+	mCapacity = std::max(capacity, mCount);
+	const GLsizeiptr instancesSize = mCapacity * sizeof(InstanceTransform);
+
+	if (mGpu) {
+		mCullShader = cullShader;
+		mCullShader.setFeedbackVaryings({ "instancePositionScale", "instanceRotation" });
+		mCullShader.compile();
+
+		//immutable storage mapped once for the whole run (4.4), written by beginUpdate while the GPU reads the other parts
+		const GLbitfield mapping = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glGenBuffers(1, &mSourceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, mSourceVBO);
+		glBufferStorage(GL_ARRAY_BUFFER, instancesSize * ringParts, NULL, mapping);
+		mMapped = (InstanceTransform*)glMapBufferRange(GL_ARRAY_BUFFER, 0, instancesSize * ringParts, mapping);
+		std::copy(instances.begin(), instances.end(), mMapped);
+		mPart = 0;
+		glGenVertexArrays(1, &mCullVAO); //attributes set by each cull, on the part of the frame
+
+		glGenBuffers(1, &mCulledVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, mCulledVBO);
+		glBufferData(GL_ARRAY_BUFFER, instancesSize * mLodCount, NULL, GL_DYNAMIC_COPY);
+		glGenQueries(mLodCount, mQueries);
+
+		//one command per mesh and level, the cull passes fill in the instance counts
+		std::vector<DrawCommand> commands;
+		for (unsigned int i = 0; i < meshes.size(); i++) {
+			for (unsigned int lod = 0; lod < mLodCount; lod++) {
+				const MeshLod& level = meshes[i].lod(lod);
+				commands.push_back({ level.indexCount, 0, level.indexOffset, 0, 0 });
+			}
+		}
+		glGenBuffers(1, &mIndirectBuffer);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), commands.data(), GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else {
+		mInstances = instances;
+		computeBounds();
+		glGenBuffers(1, &mInstanceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, mCount * sizeof(InstanceTransform), NULL, GL_STREAM_DRAW); //refilled by each cull
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	//instance transforms, one per instance
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		glBindVertexArray(meshes[i].VAO);
+		setInstanceAttributes(mGpu ? mCulledVBO : mInstanceVBO, 0);
+		glVertexAttribDivisor(3, 1);
+		glVertexAttribDivisor(4, 1);
+		glBindVertexArray(0);
+	}
+}
+
+void InstanceCuller::setInstanceCount(unsigned int count) {
+	mCount = std::min(count, mCapacity);
+	if (!mGpu)
+		mInstances.resize(mCount);
+}
+
+InstanceTransform* InstanceCuller::beginUpdate() {
+	if (!mGpu)
+		return mInstances.data();
+	//the reads of the current part were all issued during the last frame, the next part was last read two frames ago
+	mFences[mPart] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	mPart = (mPart + 1) % ringParts;
+	if (mFences[mPart] != 0) {
+		while (glClientWaitSync(mFences[mPart], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED)
+			;
+		glDeleteSync(mFences[mPart]);
+		mFences[mPart] = 0;
+	}
+	return mMapped + mPart * mCapacity;
+}
+
+void InstanceCuller::endUpdate() {
+	if (!mGpu)
+		computeBounds();
+	//the GPU path needs nothing, the mapping is coherent
+}
+
+void InstanceCuller::cull(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos, float viewportHeight, float maxPixelError) {
+	glm::vec4 planes[6];
+	frustumPlanes(projection * view, planes);
+	const float pixelScale = MeshSimplifier::pixelScale(projection, viewportHeight); //same size on screen as Model::pixelsPerUnit
+	if (mGpu)
+		cullGpu(planes, viewPos, pixelScale, maxPixelError);
+	else
+		cullCpu(planes, viewPos, pixelScale, maxPixelError);
+}
+
+void InstanceCuller::cullGpu(const glm::vec4* planes, const glm::vec3& viewPos, float pixelScale, float maxPixelError) {
+	static const GLchar* planeNames[6] = { "frustumPlanes[0]", "frustumPlanes[1]", "frustumPlanes[2]", "frustumPlanes[3]", "frustumPlanes[4]", "frustumPlanes[5]" };
+	static const GLchar* lodErrorNames[maxLods] = { "lodErrors[0]", "lodErrors[1]", "lodErrors[2]", "lodErrors[3]" };
+	mCullShader.use();
+	for (unsigned int i = 0; i < 6; i++)
+		mCullShader.setVector4f(planeNames[i], planes[i]);
+	for (unsigned int lod = 0; lod < maxLods; lod++)
+		mCullShader.setFloat(lodErrorNames[lod], mLodErrors[lod]);
+	mCullShader.setVector3f("boundsCenter", mBoundsCenter);
+	mCullShader.setFloat("boundsRadius", mBoundsRadius);
+	mCullShader.setVector3f("viewPos", viewPos);
+	mCullShader.setFloat("pixelScale", pixelScale);
+	mCullShader.setInteger("lodCount", mLodCount);
+	mCullShader.setFloat("maxPixelError", maxPixelError);
+
+	//one pass per level, each writes the visible instances of its level in its part of the culled buffer
+	const GLsizeiptr instancesSize = mCapacity * sizeof(InstanceTransform);
+	const size_t source = mPart * instancesSize;
+	glEnable(GL_RASTERIZER_DISCARD);
+	glBindVertexArray(mCullVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, mSourceVBO);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), (void*)(source + offsetof(InstanceTransform, positionScale)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), (void*)(source + offsetof(InstanceTransform, rotation)));
+	for (unsigned int lod = 0; lod < mLodCount; lod++) {
+		mCullShader.setInteger("lod", lod);
+		glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, mCulledVBO, lod * instancesSize, instancesSize);
+		glBeginQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, mQueries[lod]);
+		glBeginTransformFeedback(GL_POINTS);
+		glDrawArrays(GL_POINTS, 0, (GLsizei)mCount);
+		glEndTransformFeedback();
+		glEndQuery(GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN);
+	}
+	glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+	glBindVertexArray(0);
+	glDisable(GL_RASTERIZER_DISCARD);
+
+	//the counts go from the queries to the instance counts of the draw commands without a round trip to the CPU
+	glBindBuffer(GL_QUERY_BUFFER, mIndirectBuffer);
+	for (unsigned int mesh = 0; mesh < mMeshCount; mesh++) {
+		for (unsigned int lod = 0; lod < mLodCount; lod++) {
+			const size_t offset = (mesh * mLodCount + lod) * sizeof(DrawCommand) + offsetof(DrawCommand, instanceCount);
+			glGetQueryObjectuiv(mQueries[lod], GL_QUERY_RESULT, (GLuint*)offset);
+		}
+	}
+	glBindBuffer(GL_QUERY_BUFFER, 0);
+}
+
+void InstanceCuller::cullCpu(const glm::vec4* planes, const glm::vec3& viewPos, float pixelScale, float maxPixelError) {
+	const unsigned int count = mCount;
+	mLods.assign(count, culled);
+	unsigned int lodSizes[maxLods] = { 0 };
+	for (unsigned int first = 0; first < count; first += 4) {
+		//bit j set when the sphere of instance first + j is inside every plane
+#ifdef INSTANCE_CULLER_SSE
+		const __m128 centerX = _mm_loadu_ps(&mCenterX[first]);
+		const __m128 centerY = _mm_loadu_ps(&mCenterY[first]);
+		const __m128 centerZ = _mm_loadu_ps(&mCenterZ[first]);
+		const __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&mRadius[first]));
+		int inside = 0xF;
+		for (unsigned int i = 0; i < 6 && inside != 0; i++) {
+			__m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes[i].x), centerX), _mm_set1_ps(planes[i].w));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[i].y), centerY));
+			distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes[i].z), centerZ));
+			inside &= _mm_movemask_ps(_mm_cmpge_ps(distance, negRadius));
+		}
+#else
+		int inside = 0;
+		for (unsigned int j = 0; j < 4; j++) {
+			bool in = true;
+			for (unsigned int i = 0; i < 6 && in; i++)
+				in = planes[i].x * mCenterX[first + j] + planes[i].y * mCenterY[first + j] + planes[i].z * mCenterZ[first + j] + planes[i].w >= -mRadius[first + j];
+			inside |= in ? 1 << j : 0;
+		}
+#endif
+		for (unsigned int j = 0; j < 4 && first + j < count; j++) {
+			if ((inside & (1 << j)) == 0)
+				continue;
+			const unsigned int instance = first + j;
+			const glm::vec3 center(mCenterX[instance], mCenterY[instance], mCenterZ[instance]);
+			const float distance = glm::length(center - viewPos) - mRadius[instance];
+			unsigned int lod = 0;
+			if (distance > 0.0f) { //otherwise the camera is inside the bounding sphere, full level
+				const float pixelsPerUnit = mScale[instance] * pixelScale / distance;
+				while (lod + 1 < mLodCount && mLodErrors[lod + 1] * pixelsPerUnit <= maxPixelError)
+					lod++;
+			}
+			mLods[instance] = (unsigned char)lod;
+			lodSizes[lod]++;
+		}
+	}
+
+	//visible instances grouped by level (counting sort), each level is one instanced draw of a contiguous part of the buffer
+	unsigned int next[maxLods];
+	mLodFirst[0] = 0;
+	for (unsigned int lod = 0; lod < mLodCount; lod++) {
+		next[lod] = mLodFirst[lod];
+		mLodFirst[lod + 1] = mLodFirst[lod] + lodSizes[lod];
+	}
+	const unsigned int visible = mLodFirst[mLodCount];
+	mSortedInstances.resize(std::max(visible, 1u));
+	for (unsigned int i = 0; i < count; i++)
+		if (mLods[i] != culled)
+			mSortedInstances[next[mLods[i]]++] = mInstances[i];
+	glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+	glBufferData(GL_ARRAY_BUFFER, count * sizeof(InstanceTransform), NULL, GL_STREAM_DRAW); //orphaning, no wait on the previous draws
+	if (visible > 0)
+		glBufferSubData(GL_ARRAY_BUFFER, 0, visible * sizeof(InstanceTransform), mSortedInstances.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceCuller::draw(const Mesh& mesh, unsigned int meshIndex) {
+	glBindVertexArray(mesh.VAO);
+	if (mGpu) {
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mIndirectBuffer);
+		for (unsigned int lod = 0; lod < mLodCount; lod++) {
+			setInstanceAttributes(mCulledVBO, lod * mCapacity);
+			const size_t command = (meshIndex * mLodCount + lod) * sizeof(DrawCommand);
+			glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)command);
+		}
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	else {
+		for (unsigned int lod = 0; lod < mLodCount; lod++) {
+			const unsigned int count = mLodFirst[lod + 1] - mLodFirst[lod];
+			if (count == 0)
+				continue;
+			const MeshLod& level = mesh.lod(lod);
+			setInstanceAttributes(mInstanceVBO, mLodFirst[lod]);
+			glDrawElementsInstanced(GL_TRIANGLES, level.indexCount, GL_UNSIGNED_INT, (void*)(level.indexOffset * sizeof(unsigned int)), count);
+		}
+	}
+	glBindVertexArray(0);
+}
+
+void InstanceCuller::setInstanceAttributes(GLuint buffer, unsigned int firstInstance) {
+	const size_t offset = firstInstance * sizeof(InstanceTransform);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), (void*)(offset + offsetof(InstanceTransform, positionScale)));
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), (void*)(offset + offsetof(InstanceTransform, rotation)));
+}
+
+void InstanceCuller::computeBounds() {
+	const size_t padded = (mInstances.size() + 3) / 4 * 4;
+	mCenterX.assign(padded, 0.0f);
+	mCenterY.assign(padded, 0.0f);
+	mCenterZ.assign(padded, 0.0f);
+	mRadius.assign(padded, 0.0f);
+	mScale.assign(padded, 0.0f);
+	for (unsigned int i = 0; i < mInstances.size(); i++) {
+		const glm::vec3 center = mInstances[i].transform(mBoundsCenter);
+		mScale[i] = mInstances[i].scale();
+		mCenterX[i] = center.x;
+		mCenterY[i] = center.y;
+		mCenterZ[i] = center.z;
+		mRadius[i] = mBoundsRadius * mScale[i];
+	}
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#ifndef INSTANCE_CULLER_H
+#define INSTANCE_CULLER_H
+
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "InstanceTransform.hpp"
+#include "Mesh.hpp"
+#include "MeshSimplifier.hpp"
+#include "Shader.hpp"
+
+// Frustum culling and level of detail selection of the instances of a model (the asteroid field). The visible instances are
+// compacted in the instance buffer, grouped by level, so that each mesh draws each level with one instanced draw.
+// With GL 4.4 (query buffer objects, indirect draws) the instances are culled on the GPU: a transform feedback pass per level
+// writes the transforms of its visible instances, and its query writes the instance count in the indirect draw commands, so
+// the counts never come back to the CPU. Otherwise the bounding spheres are tested on the CPU, four at a time with SSE,
+// and the compacted transforms are uploaded.
+// The transforms can change every frame (beginUpdate, endUpdate): on the GPU path they are written straight in a
+// persistently mapped buffer split in three parts, one per frame in flight, so neither the CPU nor the GPU waits on the other.
+// The instance transforms are read from the attributes 3 and 4 of the mesh VAOs
+class InstanceCuller {
+public:
+	static const unsigned int maxLods = MeshSimplifier::maxLevels;
+
+	// Instances of a model given by its uploaded meshes, bounding sphere (model space) and level errors (Model::lodErrors).
+	// cullShader is instanceCull.vert + instanceCull.geom; gpu picks the GPU path when the context supports it.
+	// The buffers hold up to capacity instances (0: instances.size()), the most setInstanceCount accepts
+	void create(const std::vector<Mesh>& meshes, const glm::vec3& boundsCenter, float boundsRadius, const std::vector<float>& lodErrors,
+		const std::vector<InstanceTransform>& instances, Shader cullShader, bool gpu, unsigned int capacity = 0);
+
+	// Number of instances from the next beginUpdate on, clamped to the capacity (the buffers are never reallocated)
+	void setInstanceCount(unsigned int count);
+
+	// Transforms of the instances for this frame: beginUpdate gives the instanceCount() transforms to write, endUpdate hands
+	// them over to the culling and the draws. The array may be another one each frame, every transform must be written
+	InstanceTransform* beginUpdate();
+	void endUpdate();
+
+	// Culls the instances against the frustum of projection * view and selects their level (see Model::selectLod). Each cull
+	// replaces the instances the next draws use, so a frame can cull and draw once per view (camera, faces of a shadow cubemap)
+	void cull(const glm::mat4& projection, const glm::mat4& view, const glm::vec3& viewPos, float viewportHeight, float maxPixelError);
+
+	// Draws the instances of one mesh (index meshIndex in create) kept by the last cull, shader in use and vertex format set
+	void draw(const Mesh& mesh, unsigned int meshIndex);
+
+	// Points the instance transform attributes (3 and 4) of the bound VAO at the instances starting at firstInstance in buffer
+	static void setInstanceAttributes(GLuint buffer, unsigned int firstInstance);
+
+	bool gpu() const { return mGpu; }
+	unsigned int instanceCount() const { return mCount; }
+	unsigned int capacity() const { return mCapacity; }
+
+	// Instances drawn after the last cull (CPU path only, the GPU path keeps the counts on the GPU)
+	unsigned int visibleCount() const { return mLodFirst[mLodCount]; }
+
+private:
+	// Indirect draw command of glDrawElementsIndirect
+	struct DrawCommand {
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLuint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// bounding spheres and scales of the instances, in the structure of arrays the SSE test reads
+	void computeBounds();
+	void cullGpu(const glm::vec4* planes, const glm::vec3& viewPos, float pixelScale, float maxPixelError);
+	void cullCpu(const glm::vec4* planes, const glm::vec3& viewPos, float pixelScale, float maxPixelError);
+
+	bool mGpu = false;
+	unsigned int mLodCount = 1;
+	float mLodErrors[maxLods] = { 0.0f };
+	unsigned int mMeshCount = 0;
+	glm::vec3 mBoundsCenter = glm::vec3(0.0f); // of the model
+	float mBoundsRadius = 0.0f;
+	unsigned int mCount = 0;
+	unsigned int mCapacity = 0; // instances each buffer (or part of a buffer) is sized for
+	GLuint mSourceVBO = 0; // every instance, read by the cull passes (GPU path)
+
+	// GPU path
+	static const unsigned int ringParts = 3;
+	Shader mCullShader;
+	InstanceTransform* mMapped = nullptr; // mSourceVBO, persistently mapped
+	unsigned int mPart = 0; // part of mSourceVBO holding the transforms of this frame
+	GLsync mFences[ringParts] = { 0 }; // end of the GPU reads of each part
+	GLuint mCullVAO = 0;
+	GLuint mCulledVBO = 0; // instances of each level, level l from instance l * capacity()
+	GLuint mIndirectBuffer = 0; // DrawCommand of each mesh and level
+	GLuint mQueries[maxLods] = { 0 };
+
+	// CPU path
+	std::vector<InstanceTransform> mInstances;
+	std::vector<float> mCenterX, mCenterY, mCenterZ, mRadius, mScale; // padded to a multiple of 4
+	std::vector<InstanceTransform> mSortedInstances;
+	std::vector<unsigned char> mLods;
+	GLuint mInstanceVBO = 0;
+	unsigned int mLodFirst[maxLods + 1] = { 0 }; // first instance of each level in the instance buffer, and the end
+};
+
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#ifndef INSTANCE_TRANSFORM_H
+#define INSTANCE_TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Transform of an instance with a uniform scale: 32 bytes in the instance buffers instead of the 64 of a mat4, decoded by
+// instanceTransform() of Shaders/common/instanceTransform.glsl (attributes 3 and 4 of the instanced draws)
+struct InstanceTransform {
+	glm::vec4 positionScale; // translation, uniform scale
+	glm::vec4 rotation; // unit quaternion (x, y, z, w)
+
+	InstanceTransform() : positionScale(0.0f, 0.0f, 0.0f, 1.0f), rotation(0.0f, 0.0f, 0.0f, 1.0f) {}
+
+	InstanceTransform(const glm::vec3& position, float scale, const glm::quat& q)
+		: positionScale(position, scale), rotation(q.x, q.y, q.z, q.w) {}
+
+	glm::vec3 position() const { return glm::vec3(positionScale); }
+	float scale() const { return positionScale.w; }
+	glm::quat quaternion() const { return glm::quat(rotation.w, rotation.x, rotation.y, rotation.z); }
+
+	// model matrix, translation * rotation * scale
+	glm::mat4 matrix() const
+	{
+		return glm::scale(glm::translate(glm::mat4(1.0f), position()) * glm::mat4_cast(quaternion()), glm::vec3(scale()));
+	}
+
+	// model space point to world space
+	glm::vec3 transform(const glm::vec3& point) const
+	{
+		return position() + scale() * (quaternion() * point);
+	}
+};
+
+#endif
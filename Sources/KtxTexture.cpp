@@ -0,0 +1,199 @@
+#include "KtxTexture.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// KTX 1.1 header, right after the 12 bytes identifier. All the fields are little endian 32 bits values
+struct KtxFileHeader {
+	uint32_t endianness;
+	uint32_t glType;
+	uint32_t glTypeSize;
+	uint32_t glFormat;
+	uint32_t glInternalFormat;
+	uint32_t glBaseInternalFormat;
+	uint32_t pixelWidth;
+	uint32_t pixelHeight;
+	uint32_t pixelDepth;
+	uint32_t numberOfArrayElements;
+	uint32_t numberOfFaces;
+	uint32_t numberOfMipmapLevels;
+	uint32_t bytesOfKeyValueData;
+};
+
+static const unsigned char ktxIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+static const uint32_t ktxEndianness = 0x04030201;
+static const char ktxSourceHashKey[] = "StargateSourceHash"; //value: the uint64 content hash of the source image(s)
+
+static bool fileModificationTime(const std::string& path, time_t& time) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	time = info.st_mtime;
+	return true;
+}
+
+// every section of a KTX file is padded to 4 bytes
+static uint64_t padded(uint64_t size) {
+	return (size + 3u) & ~(uint64_t)3u;
+}
+
+std::string KtxTexture::bakedPath(const std::string& sourcePath) {
+	return sourcePath + ".ktx";
+}
+
+bool KtxTexture::isUpToDate(const std::string& bakedPath, const std::vector<std::string>& sourcePaths) {
+	time_t bakedTime;
+	if (!fileModificationTime(bakedPath, bakedTime))
+		return false;
+	for (unsigned int i = 0; i < sourcePaths.size(); i++) {
+		time_t sourceTime;
+		if (fileModificationTime(sourcePaths[i], sourceTime) && sourceTime > bakedTime)
+			return false;
+	}
+	return true;
+}
+
+bool KtxTexture::read(const MappedFile& file, KtxDescription& texture) {
+	const unsigned char* data = file.data();
+	const uint64_t fileSize = file.size();
+
+	KtxFileHeader header;
+	if (fileSize < sizeof(ktxIdentifier) + sizeof(header) || std::memcmp(data, ktxIdentifier, sizeof(ktxIdentifier)) != 0)
+		return false;
+	std::memcpy(&header, data + sizeof(ktxIdentifier), sizeof(header));
+	//only what the baker writes is supported: same endianness, 2D or cubemap, no array
+	if (header.endianness != ktxEndianness || header.pixelDepth != 0 || header.numberOfArrayElements != 0
+		|| (header.numberOfFaces != 1 && header.numberOfFaces != 6) || header.numberOfMipmapLevels == 0)
+		return false;
+
+	texture.glType = header.glType;
+	texture.glFormat = header.glFormat;
+	texture.glInternalFormat = header.glInternalFormat;
+	texture.glBaseInternalFormat = header.glBaseInternalFormat;
+	texture.width = header.pixelWidth;
+	texture.height = header.pixelHeight;
+	texture.faces = header.numberOfFaces;
+	texture.sourceHash = 0;
+	texture.levels.clear();
+
+	uint64_t offset = sizeof(ktxIdentifier) + sizeof(header);
+	const uint64_t keyValueEnd = offset + header.bytesOfKeyValueData;
+	if (keyValueEnd > fileSize)
+		return false;
+	while (offset + sizeof(uint32_t) <= keyValueEnd) {
+		uint32_t keyAndValueSize;
+		std::memcpy(&keyAndValueSize, data + offset, sizeof(keyAndValueSize));
+		offset += sizeof(keyAndValueSize);
+		if (offset + keyAndValueSize > keyValueEnd)
+			return false;
+		if (keyAndValueSize == sizeof(ktxSourceHashKey) + sizeof(uint64_t) && std::memcmp(data + offset, ktxSourceHashKey, sizeof(ktxSourceHashKey)) == 0)
+			std::memcpy(&texture.sourceHash, data + offset + sizeof(ktxSourceHashKey), sizeof(uint64_t));
+		offset += padded(keyAndValueSize);
+	}
+	offset = keyValueEnd;
+
+	int width = texture.width, height = texture.height;
+	for (unsigned int i = 0; i < header.numberOfMipmapLevels; i++) {
+		uint32_t imageSize;
+		if (offset + sizeof(imageSize) > fileSize)
+			return false;
+		std::memcpy(&imageSize, data + offset, sizeof(imageSize));
+		offset += sizeof(imageSize);
+		//imageSize is the size of one face for a cubemap, faces are padded to 4 bytes (always the case with the baker's formats)
+		if (offset + padded(imageSize) * texture.faces > fileSize)
+			return false;
+		KtxLevel level;
+		level.width = width;
+		level.height = height;
+		level.data = data + offset;
+		level.faceSize = imageSize;
+		texture.levels.push_back(level);
+		offset += padded(imageSize) * texture.faces;
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return true;
+}
+
+bool KtxTexture::write(const std::string& path, const KtxDescription& texture) {
+	//written to a temporary file first so that a partial file is never picked up by the runtime
+	const std::string temporaryPath = path + ".tmp";
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file)
+			return false;
+
+		const uint32_t keyAndValueSize = sizeof(ktxSourceHashKey) + sizeof(uint64_t);
+		KtxFileHeader header;
+		header.endianness = ktxEndianness;
+		header.glType = texture.glType;
+		header.glTypeSize = 1; //1 for compressed formats and for the byte formats the baker writes
+		header.glFormat = texture.glFormat;
+		header.glInternalFormat = texture.glInternalFormat;
+		header.glBaseInternalFormat = texture.glBaseInternalFormat;
+		header.pixelWidth = texture.width;
+		header.pixelHeight = texture.height;
+		header.pixelDepth = 0;
+		header.numberOfArrayElements = 0;
+		header.numberOfFaces = texture.faces;
+		header.numberOfMipmapLevels = (uint32_t)texture.levels.size();
+		header.bytesOfKeyValueData = (uint32_t)(sizeof(uint32_t) + padded(keyAndValueSize));
+		file.write((const char*)ktxIdentifier, sizeof(ktxIdentifier));
+		file.write((const char*)&header, sizeof(header));
+
+		const char zeros[4] = { 0, 0, 0, 0 };
+		file.write((const char*)&keyAndValueSize, sizeof(keyAndValueSize));
+		file.write(ktxSourceHashKey, sizeof(ktxSourceHashKey));
+		file.write((const char*)&texture.sourceHash, sizeof(uint64_t));
+		file.write(zeros, padded(keyAndValueSize) - keyAndValueSize);
+
+		for (unsigned int i = 0; i < texture.levels.size(); i++) {
+			const KtxLevel& level = texture.levels[i];
+			uint32_t imageSize = (uint32_t)level.faceSize;
+			file.write((const char*)&imageSize, sizeof(imageSize));
+			for (int face = 0; face < texture.faces; face++) {
+				file.write((const char*)level.data + face * level.faceSize, level.faceSize);
+				file.write(zeros, padded(level.faceSize) - level.faceSize);
+			}
+		}
+		if (!file)
+			return false;
+	}
+	std::remove(path.c_str());
+	return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
+
+GLuint KtxTexture::upload(const KtxDescription& texture) {
+	if (texture.isCompressed() && !GLAD_GL_EXT_texture_compression_s3tc)
+		return 0;
+
+	GLenum target = texture.faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+	glBindTexture(target, textureID);
+	//uncompressed rows are padded to 4 bytes in KTX files, which is the default unpack alignment
+	for (unsigned int i = 0; i < texture.levels.size(); i++) {
+		const KtxLevel& level = texture.levels[i];
+		for (int face = 0; face < texture.faces; face++) {
+			GLenum faceTarget = texture.faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+			const unsigned char* faceData = level.data + face * ((level.faceSize + 3) & ~(size_t)3);
+			if (texture.isCompressed())
+				glCompressedTexImage2D(faceTarget, i, texture.glInternalFormat, level.width, level.height, 0, (GLsizei)level.faceSize, faceData);
+			else
+				glTexImage2D(faceTarget, i, texture.glInternalFormat, level.width, level.height, 0, texture.glFormat, texture.glType, faceData);
+		}
+	}
+	GLenum wrap = target == GL_TEXTURE_CUBE_MAP ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+	glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+	glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+	glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+	glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)texture.levels.size() - 1);
+	glTexParameteri(target, GL_TEXTURE_MIN_FILTER, texture.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(target, 0);
+	return textureID;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef KTX_TEXTURE_H
+#define KTX_TEXTURE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+#include "MappedFile.hpp"
+
+// One mip level of a KTX texture. For a cubemap the 6 faces follow each other, faceSize bytes each
+struct KtxLevel {
+	int width = 0;
+	int height = 0;
+	const unsigned char* data = nullptr;
+	size_t faceSize = 0;
+};
+
+// Description of a whole KTX texture, the level data is not owned (it points into a mapped file or into the baker's buffers)
+struct KtxDescription {
+	GLenum glType = 0; //0 for compressed formats
+	GLenum glFormat = 0; //0 for compressed formats
+	GLenum glInternalFormat = 0;
+	GLenum glBaseInternalFormat = 0;
+	int width = 0;
+	int height = 0;
+	int faces = 1; //1 or 6 (cubemap)
+	uint64_t sourceHash = 0; //content hash of the source image(s), stored as key/value data so that baked textures are deduplicated like the others
+	std::vector<KtxLevel> levels;
+
+	bool isCompressed() const { return glType == 0; }
+};
+
+// Textures baked offline (see TextureBaker) in the KTX 1.1 container: the whole mip chain is stored ready to be uploaded,
+// optionally block compressed (S3TC), so that loading is a mapping of the file and a copy to the driver.
+// Baked files live next to their source image (e.g. Models/2k_sun.jpg.ktx)
+class KtxTexture {
+public:
+	// Path of the baked file of a source image
+	static std::string bakedPath(const std::string& sourcePath);
+
+	// True if the baked file exists and is newer than all its sources
+	static bool isUpToDate(const std::string& bakedPath, const std::vector<std::string>& sourcePaths);
+
+	// Reads the description of a mapped KTX file, the levels point into the mapping. Returns false if the file is invalid
+	static bool read(const MappedFile& file, KtxDescription& texture);
+
+	// Writes a KTX file. Returns false if the file could not be written
+	static bool write(const std::string& path, const KtxDescription& texture);
+
+	// Creates a texture (2D or cubemap) from a description, with all its mip levels (GL thread only).
+	// Returns 0 if the format is not supported by the driver (the caller then loads the source image instead)
+	static GLuint upload(const KtxDescription& texture);
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "LightClusters.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+void LightClusters::build(const std::vector<LightSource*>& lights, const std::vector<float>& radii, const glm::mat4& view, const glm::mat4& projection) {
+	//planes of a glm::perspective matrix: [3][2] = -2fn/(f-n), [2][2] = -(f+n)/(f-n)
+	mProjection = projection;
+	mNear = projection[3][2] / (projection[2][2] - 1.0f);
+	mFar = projection[3][2] / (projection[2][2] + 1.0f);
+	mSliceScale = depthSlices / std::log(mFar / mNear);
+	mSliceBias = -std::log(mNear) * mSliceScale;
+
+	//clusters of each light and length of each list
+	mRanges.assign(clusterCount, glm::uvec2(0));
+	mBoxes.resize(lights.size());
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		ClusterBox& box = mBoxes[i];
+		if (!std::isfinite(radii[i])) { //directional and unattenuated lights reach every cluster
+			box = { 0, tilesX - 1, 0, tilesY - 1, 0, depthSlices - 1 };
+		}
+		else if (!clusterBox(glm::vec3(view * glm::vec4(glm::vec3(lights[i]->Position), 1.0f)), radii[i], box)) {
+			box.minX = -1;
+			continue;
+		}
+		for (int z = box.minZ; z <= box.maxZ; z++)
+			for (int y = box.minY; y <= box.maxY; y++)
+				for (int x = box.minX; x <= box.maxX; x++)
+					mRanges[x + tilesX * (y + tilesY * z)].y++;
+	}
+
+	//lists laid out one after the other, within the limits
+	unsigned int offset = 0;
+	for (glm::uvec2& range : mRanges) {
+		range.x = offset;
+		range.y = std::min<unsigned int>(std::min<unsigned int>(range.y, maxLightsPerCluster), maxIndices - offset);
+		offset += range.y;
+	}
+
+	//lights written in the order of the list, a full list ignores the next ones
+	mIndices.resize(offset);
+	mCursor.assign(clusterCount, 0);
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		const ClusterBox& box = mBoxes[i];
+		if (box.minX < 0)
+			continue;
+		for (int z = box.minZ; z <= box.maxZ; z++)
+			for (int y = box.minY; y <= box.maxY; y++)
+				for (int x = box.minX; x <= box.maxX; x++) {
+					const int cluster = x + tilesX * (y + tilesY * z);
+					if (mCursor[cluster] < mRanges[cluster].y)
+						mIndices[mRanges[cluster].x + mCursor[cluster]++] = (uint16_t)i;
+				}
+	}
+}
+
+int LightClusters::depthSlice(float depth) const {
+	const int slice = (int)std::floor(std::log(std::max(depth, mNear)) * mSliceScale + mSliceBias);
+	return std::min(std::max(slice, 0), depthSlices - 1);
+}
+
+int LightClusters::clusterIndex(const glm::vec2& ndc, float depth) const {
+	if (ndc.x < -1.0f || ndc.x > 1.0f || ndc.y < -1.0f || ndc.y > 1.0f || depth < mNear || depth > mFar)
+		return -1;
+	const int x = std::min((int)std::floor((ndc.x * 0.5f + 0.5f) * tilesX), tilesX - 1);
+	const int y = std::min((int)std::floor((ndc.y * 0.5f + 0.5f) * tilesY), tilesY - 1);
+	return x + tilesX * (y + tilesY * depthSlice(depth));
+}
+
+void LightClusters::lightsOf(int cluster, std::vector<int>& lights) const {
+	lights.clear();
+	if (cluster < 0 || cluster >= (int)mRanges.size())
+		return;
+	for (unsigned int i = 0; i < mRanges[cluster].y; i++)
+		lights.push_back(mIndices[mRanges[cluster].x + i]);
+}
+
+bool LightClusters::clusterBox(const glm::vec3& center, float radius, ClusterBox& box) const {
+	//depth range of the sphere inside the frustum
+	const float depth = -center.z;
+	if (depth + radius < mNear || depth - radius > mFar)
+		return false;
+	const float minDepth = std::max(depth - radius, mNear);
+	const float maxDepth = std::min(depth + radius, mFar);
+
+	//the NDC position is linear in x/depth and y/depth, so the corners of the box around the sphere bound it on screen
+	glm::vec2 minNdc(std::numeric_limits<float>::max()), maxNdc(-std::numeric_limits<float>::max());
+	for (int corner = 0; corner < 8; corner++) {
+		const glm::vec4 point(center.x + ((corner & 1) ? radius : -radius), center.y + ((corner & 2) ? radius : -radius),
+			-((corner & 4) ? maxDepth : minDepth), 1.0f);
+		const glm::vec4 clip = mProjection * point;
+		const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+		minNdc = glm::min(minNdc, ndc);
+		maxNdc = glm::max(maxNdc, ndc);
+	}
+	if (maxNdc.x < -1.0f || minNdc.x > 1.0f || maxNdc.y < -1.0f || minNdc.y > 1.0f)
+		return false;
+
+	box.minX = std::max((int)std::floor((minNdc.x * 0.5f + 0.5f) * tilesX), 0);
+	box.maxX = std::min((int)std::floor((maxNdc.x * 0.5f + 0.5f) * tilesX), tilesX - 1);
+	box.minY = std::max((int)std::floor((minNdc.y * 0.5f + 0.5f) * tilesY), 0);
+	box.maxY = std::min((int)std::floor((maxNdc.y * 0.5f + 0.5f) * tilesY), tilesY - 1);
+	box.minZ = depthSlice(minDepth);
+	box.maxZ = depthSlice(maxDepth);
+	return true;
+}
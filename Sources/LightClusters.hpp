@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "LightSource.h"
+
+// Clustered forward lighting, CPU side: the view frustum is cut into tilesX * tilesY screen tiles and depthSlices depth
+// slices (exponential, so that the clusters stay roughly cubic far away), and each light is binned in the clusters its
+// sphere of influence touches. The fragment shaders find their cluster the same way (clusterIndex, see
+// Shaders/common/lights.glsl) and only evaluate the lights of its list
+class LightClusters {
+public:
+	static const int tilesX = 16;
+	static const int tilesY = 9;
+	static const int depthSlices = 24;
+	static const int clusterCount = tilesX * tilesY * depthSlices;
+	static const int maxLightsPerCluster = 64; // the lights past it are dropped, in the order of the light list
+	static const int maxIndices = 65536; // GL_MAX_TEXTURE_BUFFER_SIZE guaranteed by OpenGL 3.3
+
+	// Bins the lights (radii are their influence radii, see LightCulling) for that camera, the planes are read from the
+	// projection matrix
+	void build(const std::vector<LightSource*>& lights, const std::vector<float>& radii, const glm::mat4& view, const glm::mat4& projection);
+
+	// Cluster of a point given by its NDC position and its view space depth (distance along the view direction),
+	// -1 outside of the frustum. Same computation as the shaders
+	int clusterIndex(const glm::vec2& ndc, float depth) const;
+
+	// Depth slice of a view space depth, clamped to the slices
+	int depthSlice(float depth) const;
+
+	// Light indices of a cluster, in the order of the light list
+	void lightsOf(int cluster, std::vector<int>& lights) const;
+
+	// Per cluster: offset of its list in indices() and number of lights
+	const std::vector<glm::uvec2>& ranges() const { return mRanges; }
+	// Light lists of the clusters, one after the other
+	const std::vector<uint16_t>& indices() const { return mIndices; }
+
+	float nearPlane() const { return mNear; }
+	float farPlane() const { return mFar; }
+	// slice = log(depth) * sliceScale + sliceBias
+	float sliceScale() const { return mSliceScale; }
+	float sliceBias() const { return mSliceBias; }
+
+private:
+	// Clusters touched by a light, inclusive ranges
+	struct ClusterBox {
+		int minX, maxX, minY, maxY, minZ, maxZ;
+	};
+
+	// Clusters of the screen bounds of the sphere (view space) over its depth range, false if it is out of the frustum
+	bool clusterBox(const glm::vec3& center, float radius, ClusterBox& box) const;
+
+	glm::mat4 mProjection = glm::mat4(1.0f);
+	float mNear = 0.1f;
+	float mFar = 1.0f;
+	float mSliceScale = 0.0f;
+	float mSliceBias = 0.0f;
+
+	std::vector<glm::uvec2> mRanges;
+	std::vector<uint16_t> mIndices;
+	std::vector<ClusterBox> mBoxes; // of each light, -1 minX if culled
+	std::vector<unsigned int> mCursor; // kept to avoid allocating each view
+};
+
+#endif
@@ -0,0 +1,60 @@
+#include "LightCulling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+const float LightCulling::cutoff = 1.0f / 256.0f;
+
+static float peakBrightness(const LightSource& light) {
+	glm::vec3 color = glm::max(light.Diffuse, light.Specular);
+	return std::max(color.r, std::max(color.g, color.b));
+}
+
+float LightCulling::influenceRadius(const LightSource& light) {
+	if (light.Position.w == 0.0f || light.AttenuationBool != 1)
+		return std::numeric_limits<float>::infinity();
+
+	//constant + linear * d + quadratic * d^2 = peak / cutoff
+	const float c = light.AttenuationConstant - peakBrightness(light) / cutoff;
+	const float l = light.AttenuationLinear;
+	const float q = light.AttenuationQuadratic;
+	if (c >= 0.0f) //already under the cutoff at the light position
+		return 0.0f;
+	if (q > 0.0f)
+		return (-l + std::sqrt(l * l - 4.0f * q * c)) / (2.0f * q);
+	if (l > 0.0f)
+		return -c / l;
+	return std::numeric_limits<float>::infinity();
+}
+
+float LightCulling::brightnessAt(const LightSource& light, float distance) {
+	if (light.Position.w == 0.0f || light.AttenuationBool != 1)
+		return peakBrightness(light);
+	const float attenuation = light.AttenuationConstant + light.AttenuationLinear * distance + light.AttenuationQuadratic * distance * distance;
+	return attenuation > 0.0f ? peakBrightness(light) / attenuation : std::numeric_limits<float>::infinity();
+}
+
+void LightCulling::select(const std::vector<LightSource*>& lights, const std::vector<float>& radii, const glm::vec3& center, float radius,
+	unsigned int maxLights, std::vector<int>& selected, std::vector<std::pair<float, int> >& candidates) {
+	candidates.clear(); //brightness on the sphere, index
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		const LightSource& light = *lights[i];
+		float distance = 0.0f; //from the light to the closest point of the sphere
+		if (light.Position.w != 0.0f) {
+			distance = std::max(glm::length(glm::vec3(light.Position) - center) - radius, 0.0f);
+			if (distance > radii[i])
+				continue;
+		}
+		candidates.push_back(std::make_pair(brightnessAt(light, distance), (int)i));
+	}
+
+	//brightest first, the insertion order breaks the ties so that the list is stable from frame to frame
+	const size_t kept = std::min<size_t>(candidates.size(), maxLights);
+	std::partial_sort(candidates.begin(), candidates.begin() + kept, candidates.end(),
+		[](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first || (a.first == b.first && a.second < b.second); });
+	selected.clear();
+	for (size_t i = 0; i < kept; i++)
+		selected.push_back(candidates[i].second);
+}
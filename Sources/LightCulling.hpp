@@ -0,0 +1,35 @@
+#pragma once
+
+#ifndef LIGHT_CULLING_H
+#define LIGHT_CULLING_H
+
+#include <utility>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "LightSource.h"
+
+// Selection of the lights worth evaluating for an object: each light reaches as far as its attenuation keeps it above a
+// cutoff brightness, the lights whose sphere of influence touches the bounding sphere of the object are kept, the brightest
+// on the object first
+class LightCulling {
+public:
+	// brightness (largest color component of the light) under which a light is considered to have no effect
+	static const float cutoff;
+
+	// distance at which the attenuated brightness of the light falls under the cutoff, infinite for directional lights
+	// and lights without attenuation
+	static float influenceRadius(const LightSource& light);
+
+	// brightness of the light at that distance of its position (attenuation only, no spotlight cone)
+	static float brightnessAt(const LightSource& light, float distance);
+
+	// indices (in lights) of at most maxLights lights reaching the sphere, sorted by decreasing brightness on the sphere.
+	// radii are the influence radii of the lights, in the same order. candidates is scratch space (brightness, index), kept by
+	// the caller so that selecting the lights of each object does not allocate
+	static void select(const std::vector<LightSource*>& lights, const std::vector<float>& radii, const glm::vec3& center, float radius,
+		unsigned int maxLights, std::vector<int>& selected, std::vector<std::pair<float, int> >& candidates);
+};
+
+#endif
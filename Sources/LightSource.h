@@ -1,5 +1,6 @@
 #pragma once
 // Std. Includes
+#include <algorithm>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -17,6 +18,8 @@
 
 #include "Shader.hpp"
 
+using namespace std;
+
 enum lightType {
 	POINTLIGHT,
 	DIRECTIONALLIGHT,
@@ -311,7 +314,7 @@ public:
 		(*lightCounter)++;
 	}
 
-	void draw(Shader shader, glm::mat4 modelMatrix, glm::mat4 viewMatrix, glm::mat4 projectionMatrix, glm::vec3 viewPos) {
+	void draw(Shader& shader, glm::mat4 modelMatrix, glm::mat4 viewMatrix, glm::mat4 projectionMatrix, glm::vec3 viewPos) {
 		shader.use();
 		if (this->type == POINTLIGHT || this->type == SPOTLIGHT) { //only point lights are drawn
 			glm::mat4 model = glm::translate(modelMatrix, glm::vec3(this->Position));
@@ -343,24 +346,6 @@ public:
 		this->Direction = pos;
 	}
 
-	//Need to make sure the shader is "use()" before !!!!! and does not set textures !!!
-	void setModelShaderLightParameters(Shader shader, int lightNumber) {
-		string number = to_string(lightNumber);
-
-		shader.setVector3f(("light[" + number + "].ambient").c_str(), this->Ambient);
-		shader.setVector3f(("light[" + number + "].diffuse").c_str(), this->Diffuse);
-		shader.setVector3f(("light[" + number + "].specular").c_str(), this->Specular);
-		shader.setVector4f(("light[" + number + "].position").c_str(), this->Position);
-		shader.setInteger(("light[" + number + "].spotlight").c_str(), this->SpotlightBool);
-		shader.setFloat(("light[" + number + "].innerCutOff").c_str(), this->InnerCutOff);
-		shader.setFloat(("light[" + number + "].outerCutOff").c_str(), this->OuterCutOff);
-		shader.setVector3f(("light[" + number + "].direction").c_str(), this->Direction);
-		shader.setInteger(("light[" + number + "].attenuationBool").c_str(), this->AttenuationBool);
-		shader.setFloat(("light[" + number + "].constant").c_str(), this->AttenuationConstant);
-		shader.setFloat(("light[" + number + "].linear").c_str(), this->AttenuationLinear);
-		shader.setFloat(("light[" + number + "].quadratic").c_str(), this->AttenuationQuadratic);		
-	}
-
 	//This function can be called to retrieve the VAO for other smilar light sources
 	GLuint getVAO() {
 		return this->VAO;
@@ -0,0 +1,88 @@
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile() : mData(nullptr), mSize(0), mFile(INVALID_HANDLE_VALUE), mMapping(nullptr) {
+}
+#else
+MappedFile::MappedFile() : mData(nullptr), mSize(0), mFile(-1) {
+}
+#endif
+
+MappedFile::~MappedFile() {
+	close();
+}
+
+bool MappedFile::open(const std::string& path) {
+	close();
+#ifdef _WIN32
+	mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (mFile == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(mFile, &fileSize) || fileSize.QuadPart == 0) {
+		close();
+		return false;
+	}
+	mMapping = CreateFileMappingA(mFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mMapping == nullptr) {
+		close();
+		return false;
+	}
+	mData = (const unsigned char*)MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0);
+	if (mData == nullptr) {
+		close();
+		return false;
+	}
+	mSize = (size_t)fileSize.QuadPart;
+#else
+	mFile = ::open(path.c_str(), O_RDONLY);
+	if (mFile < 0)
+		return false;
+	struct stat info;
+	if (fstat(mFile, &info) != 0 || info.st_size == 0) {
+		close();
+		return false;
+	}
+	void* mapping = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, mFile, 0);
+	if (mapping == MAP_FAILED) {
+		close();
+		return false;
+	}
+	madvise(mapping, (size_t)info.st_size, MADV_SEQUENTIAL); //the file is read once from start to end
+	mData = (const unsigned char*)mapping;
+	mSize = (size_t)info.st_size;
+#endif
+	return true;
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+	if (mData != nullptr)
+		UnmapViewOfFile(mData);
+	if (mMapping != nullptr)
+		CloseHandle(mMapping);
+	if (mFile != INVALID_HANDLE_VALUE)
+		CloseHandle(mFile);
+	mMapping = nullptr;
+	mFile = INVALID_HANDLE_VALUE;
+#else
+	if (mData != nullptr)
+		munmap((void*)mData, mSize);
+	if (mFile >= 0)
+		::close(mFile);
+	mFile = -1;
+#endif
+	mData = nullptr;
+	mSize = 0;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file (CreateFileMapping on Windows, mmap elsewhere).
+// The content is paged in by the OS on access, so data can be handed to the driver without any intermediate heap copy
+class MappedFile {
+public:
+	MappedFile();
+	~MappedFile();
+
+	// Maps the whole file, returns false if it does not exist, is empty or cannot be mapped
+	bool open(const std::string& path);
+	void close();
+
+	bool isOpen() const { return mData != nullptr; }
+	const unsigned char* data() const { return mData; }
+	size_t size() const { return mSize; }
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+private:
+	const unsigned char* mData;
+	size_t mSize;
+#ifdef _WIN32
+	void* mFile;
+	void* mMapping;
+#else
+	int mFile;
+#endif
+};
+
+#endif
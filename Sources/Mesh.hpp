@@ -5,6 +5,7 @@
 #include <sstream>
 #include <iostream>
 #include <vector>
+#include <utility>
 
 // GL Includes
 #include <glad/glad.h>
@@ -12,6 +13,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include "Shader.hpp"
+#include "VertexPacking.hpp"
 
 using namespace std;
 
@@ -42,6 +44,13 @@ struct Material {
 	float Shininess;
 };
 
+// Level of detail of a mesh: a range of its index buffer, all the levels share the vertices of the full mesh
+struct MeshLod {
+	unsigned int indexOffset; // in indices
+	unsigned int indexCount;
+	float error; // largest distance a vertex moved compared to the full mesh (model space), 0 for the full mesh
+};
+
 class Mesh {
 public:
 	/*  Mesh Data  */
@@ -50,50 +59,55 @@ public:
 	vector<Texture> textures;
 	Material material;
 	unsigned int VAO;
+	unsigned int indexCount; // of the full mesh (level 0)
+	vector<MeshLod> lods; // levels of detail, from the full mesh to the coarsest
+	glm::vec3 boundsCenter; // bounding sphere (model space)
+	float boundsRadius;
+	bool packedVertices; // quantized PackedVertex layout in the VBO instead of Vertex
+	VertexQuantization quantization; // bounding box decoding the packed positions
 
 	/*  Functions  */
-	// constructor
-	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, Material material)
+	// constructor, the data is moved in (pass temporaries or std::move to avoid copying the arrays)
+	Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, Material material, bool quantized = false)
 	{
-		this->vertices = vertices;
-		this->indices = indices;
-		this->textures = textures;
+		this->vertices = std::move(vertices);
+		this->indices = std::move(indices);
+		this->textures = std::move(textures);
 		this->material = material;
+		this->indexCount = (unsigned int)this->indices.size();
+		this->packedVertices = quantized;
+		setLods(vector<MeshLod>());
+		setupSamplerNames();
 
 		// now that we have all the required data, set the vertex buffers and its attribute pointers.
-		setupMesh();
+		setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
 	}
 
-	// render the mesh
-	void Draw(Shader shader)
+	// constructor uploading the vertex data directly from memory owned by the caller (e.g. a memory mapped cache file).
+	// Nothing is kept on the CPU side: vertices and indices stay empty and the data only lives in the GL buffers.
+	// indexData holds the index lists of all the levels of detail back to back (no lods: the whole array is the full mesh)
+	Mesh(const Vertex* vertexData, unsigned int vertexCount, const unsigned int* indexData, unsigned int indexCount, vector<Texture> textures, Material material,
+		vector<MeshLod> lods = vector<MeshLod>(), bool quantized = false)
 	{
-		// bind appropriate textures
-		unsigned int diffuseNr = 1;
-		unsigned int specularNr = 1;
-		unsigned int normalNr = 1;
-		unsigned int heightNr = 1;
-		unsigned int emissionNr = 1;
+		this->textures = std::move(textures);
+		this->material = material;
+		this->indexCount = indexCount;
+		this->packedVertices = quantized;
+		setLods(std::move(lods));
+		setupSamplerNames();
 
+		setupMesh(vertexData, vertexCount, indexData, indexCount);
+	}
+
+	// render the mesh, at the given level of detail (clamped to the levels the mesh has)
+	void Draw(Shader& shader, unsigned int level = 0)
+	{
+		// bind appropriate textures
 		for (unsigned int i = 0; i < textures.size(); i++)
 		{
 			glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-			// retrieve texture number (the N in diffuse_textureN)
-			string number;
-			string name = textures[i].type;
-			if (name == "texture_diffuse")
-				number = std::to_string(diffuseNr++);
-			else if (name == "texture_specular")
-				number = std::to_string(specularNr++); // transfer unsigned int to stream
-			else if (name == "texture_normal")
-				number = std::to_string(normalNr++); // transfer unsigned int to stream
-			else if (name == "texture_height")
-				number = std::to_string(heightNr++); // transfer unsigned int to stream
-			else if (name == "texture_emission")
-				number = std::to_string(emissionNr++); // transfer unsigned int to stream
-
-													 // now set the sampler to the correct texture unit
-			//glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-			shader.setInteger(("material." + name + number).c_str(), i);
+			// now set the sampler to the correct texture unit
+			shader.setInteger(samplerNames[i].c_str(), i);
 			// and finally bind the texture
 			glBindTexture(GL_TEXTURE_2D, textures[i].id);
 		}
@@ -110,38 +124,143 @@ public:
 		else {//if there are texture maps, base color is less important
 			shader.setFloat("material.mixRatio", 0.5);
 		}
+		setVertexFormat(shader);
 		// draw mesh
+		const MeshLod& drawn = lod(level);
 		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+		glDrawElements(GL_TRIANGLES, drawn.indexCount, GL_UNSIGNED_INT, (void*)(drawn.indexOffset * sizeof(unsigned int)));
 		glBindVertexArray(0);
 
 		// always good practice to set everything back to defaults once configured.
 		glActiveTexture(GL_TEXTURE0);
 	}
 
+	// tells the vertex shader how to decode the attributes of this mesh (needed as well by code drawing the VAO itself)
+	void setVertexFormat(Shader& shader) const
+	{
+		shader.setInteger("packedVertices", packedVertices ? 1 : 0);
+		shader.setVector3f("positionOffset", quantization.offset);
+		shader.setVector3f("positionScale", quantization.scale);
+	}
+
+	// level of detail clamped to the coarsest one the mesh has
+	const MeshLod& lod(unsigned int level) const
+	{
+		return lods[level < lods.size() ? level : lods.size() - 1];
+	}
+
 private:
 	/*  Render data  */
 	unsigned int VBO, EBO;
+	vector<string> samplerNames; // uniform of each texture ("material.texture_diffuse1"...), built once instead of at every draw
 
 	/*  Functions    */
+	// names the sampler of each texture: the N-th texture of a type goes to material.<type>N
+	void setupSamplerNames()
+	{
+		unsigned int diffuseNr = 1;
+		unsigned int specularNr = 1;
+		unsigned int normalNr = 1;
+		unsigned int heightNr = 1;
+		unsigned int emissionNr = 1;
+		samplerNames.clear();
+		for (unsigned int i = 0; i < textures.size(); i++)
+		{
+			// retrieve texture number (the N in diffuse_textureN)
+			string number;
+			string name = textures[i].type;
+			if (name == "texture_diffuse")
+				number = std::to_string(diffuseNr++);
+			else if (name == "texture_specular")
+				number = std::to_string(specularNr++); // transfer unsigned int to stream
+			else if (name == "texture_normal")
+				number = std::to_string(normalNr++); // transfer unsigned int to stream
+			else if (name == "texture_height")
+				number = std::to_string(heightNr++); // transfer unsigned int to stream
+			else if (name == "texture_emission")
+				number = std::to_string(emissionNr++); // transfer unsigned int to stream
+			samplerNames.push_back("material." + name + number);
+		}
+	}
+
+	// without levels of detail the mesh only has its full level, made of all the indices
+	void setLods(vector<MeshLod> levels)
+	{
+		lods = std::move(levels);
+		if (lods.empty())
+		{
+			MeshLod full;
+			full.indexOffset = 0;
+			full.indexCount = indexCount;
+			full.error = 0.0f;
+			lods.push_back(full);
+		}
+		indexCount = lods[0].indexCount;
+	}
+
+	// bounding sphere around the center of the bounding box
+	void computeBounds(const Vertex* vertexData, size_t vertexCount)
+	{
+		boundsCenter = glm::vec3(0.0f);
+		boundsRadius = 0.0f;
+		if (vertexCount == 0)
+			return;
+		glm::vec3 minimum = vertexData[0].Position, maximum = vertexData[0].Position;
+		for (size_t i = 1; i < vertexCount; i++)
+		{
+			minimum = glm::min(minimum, vertexData[i].Position);
+			maximum = glm::max(maximum, vertexData[i].Position);
+		}
+		boundsCenter = (minimum + maximum) * 0.5f;
+		for (size_t i = 0; i < vertexCount; i++)
+			boundsRadius = glm::max(boundsRadius, glm::length(vertexData[i].Position - boundsCenter));
+	}
+
 	// initializes all the buffer objects/arrays
-	void setupMesh()
+	void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount)
 	{
+		computeBounds(vertexData, vertexCount);
+
 		// create buffers/arrays
 		glGenVertexArrays(1, &VAO);
 		glGenBuffers(1, &VBO);
 		glGenBuffers(1, &EBO);
 
 		glBindVertexArray(VAO);
-		// load data into vertex buffers
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
+
 		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		if (packedVertices) {
+			// 20 bytes per vertex instead of 56: normalized shorts are turned back to floats in [-1,1] by the vertex fetch,
+			// positions are rescaled and normals/tangents decoded in the shaders, the bitangent is rebuilt from its sign (in position.w)
+			quantization = computeVertexQuantization(vertexData, vertexCount);
+			vector<PackedVertex> packed;
+			packVertices(vertexData, vertexCount, quantization, packed);
+			glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+
+			// vertex Positions (and bitangent sign)
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 4, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+			// vertex normals
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+			// vertex texture coords
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+			// vertex tangent
+			glEnableVertexAttribArray(3);
+			glVertexAttribPointer(3, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+			// no bitangent attribute
+			glDisableVertexAttribArray(4);
+
+			glBindVertexArray(0);
+			return;
+		}
 		// A great thing about structs is that their memory layout is sequential for all its items.
 		// The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
 		// again translates to 3/2 floats which translates to a byte array.
-		glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+		glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);
 
 		// set the vertex attribute pointers
 		// vertex Positions
@@ -0,0 +1,180 @@
+#include "MeshCache.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+// On-disk headers, all members are 4 bytes wide so that every section of the file stays 4-bytes aligned
+struct MeshCacheFileHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t vertexSize; //sizeof(Vertex) and sizeof(Material) when written, a cache from a build with another layout is rejected
+	uint32_t materialSize;
+	uint32_t meshCount;
+};
+
+struct MeshCacheMeshHeader {
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	uint32_t lodCount;
+	uint32_t textureCount;
+	Material material;
+};
+
+static const char meshCacheMagic[4] = { 'S', 'G', 'M', 'C' };
+
+static bool fileModificationTime(const std::string& path, time_t& time) {
+	struct stat info;
+	if (stat(path.c_str(), &info) != 0)
+		return false;
+	time = info.st_mtime;
+	return true;
+}
+
+// strings are padded with zeros up to a multiple of 4 bytes
+static uint32_t paddedLength(uint32_t length) {
+	return (length + 3u) & ~3u;
+}
+
+std::string MeshCache::cachePath(const std::string& modelPath) {
+	return modelPath + ".meshcache";
+}
+
+bool MeshCache::isUpToDate(const std::string& modelPath) {
+	time_t cacheTime, sourceTime;
+	if (!fileModificationTime(cachePath(modelPath), cacheTime))
+		return false;
+	if (!fileModificationTime(modelPath, sourceTime) || sourceTime > cacheTime)
+		return false;
+	//materials of .obj files live in a .mtl next to them, editing it must invalidate the cache as well
+	size_t extension = modelPath.find_last_of('.');
+	if (extension != std::string::npos) {
+		time_t materialTime;
+		if (fileModificationTime(modelPath.substr(0, extension) + ".mtl", materialTime) && materialTime > cacheTime)
+			return false;
+	}
+	return true;
+}
+
+bool MeshCache::read(const MappedFile& file, vector<MeshData>& meshes) {
+	const unsigned char* data = file.data();
+	const uint64_t fileSize = file.size();
+
+	MeshCacheFileHeader header;
+	if (fileSize < sizeof(header))
+		return false;
+	std::memcpy(&header, data, sizeof(header));
+	if (std::memcmp(header.magic, meshCacheMagic, sizeof(meshCacheMagic)) != 0 || header.version != MESH_CACHE_VERSION
+		|| header.vertexSize != sizeof(Vertex) || header.materialSize != sizeof(Material))
+		return false;
+
+	uint64_t offset = sizeof(header);
+	//never trust the counts of a truncated or corrupted file, not even to size the arrays
+	if ((uint64_t)header.meshCount * sizeof(MeshCacheMeshHeader) > fileSize - offset)
+		return false;
+	meshes.clear();
+	meshes.resize(header.meshCount);
+	for (unsigned int i = 0; i < header.meshCount; i++) {
+		MeshCacheMeshHeader meshHeader;
+		if (offset + sizeof(meshHeader) > fileSize)
+			return false;
+		std::memcpy(&meshHeader, data + offset, sizeof(meshHeader));
+		offset += sizeof(meshHeader);
+		//never trust the counts of a truncated or corrupted file
+		const uint64_t verticesSize = (uint64_t)meshHeader.vertexCount * sizeof(Vertex);
+		const uint64_t indicesSize = (uint64_t)meshHeader.indexCount * sizeof(unsigned int);
+		const uint64_t lodsSize = (uint64_t)meshHeader.lodCount * sizeof(MeshLod);
+		if (offset + verticesSize + indicesSize + lodsSize > fileSize)
+			return false;
+
+		//every section is 4-bytes aligned in the file and the mapping itself is page aligned, so the arrays can be used in place
+		MeshData& mesh = meshes[i];
+		mesh.material = meshHeader.material;
+		mesh.vertexCount = meshHeader.vertexCount;
+		mesh.vertices = (const Vertex*)(data + offset);
+		offset += verticesSize;
+		mesh.indexCount = meshHeader.indexCount;
+		mesh.indices = (const unsigned int*)(data + offset);
+		offset += indicesSize;
+		mesh.lods.resize(meshHeader.lodCount);
+		for (unsigned int j = 0; j < meshHeader.lodCount; j++) {
+			std::memcpy(&mesh.lods[j], data + offset, sizeof(MeshLod));
+			offset += sizeof(MeshLod);
+			if ((uint64_t)mesh.lods[j].indexOffset + mesh.lods[j].indexCount > mesh.indexCount)
+				return false;
+		}
+
+		if ((uint64_t)meshHeader.textureCount * 2 * sizeof(uint32_t) > fileSize - offset)
+			return false;
+		mesh.textures.resize(meshHeader.textureCount);
+		for (unsigned int j = 0; j < meshHeader.textureCount; j++) {
+			uint32_t lengths[2]; //type, path
+			if (offset + sizeof(lengths) > fileSize)
+				return false;
+			std::memcpy(lengths, data + offset, sizeof(lengths));
+			offset += sizeof(lengths);
+			if (offset + paddedLength(lengths[0]) + paddedLength(lengths[1]) > fileSize)
+				return false;
+			mesh.textures[j].id = 0;
+			mesh.textures[j].type.assign((const char*)data + offset, lengths[0]);
+			offset += paddedLength(lengths[0]);
+			mesh.textures[j].path.assign((const char*)data + offset, lengths[1]);
+			offset += paddedLength(lengths[1]);
+		}
+	}
+	return true;
+}
+
+bool MeshCache::write(const std::string& path, const vector<MeshData>& meshes) {
+	//written to a temporary file first so that a crash while writing never leaves a truncated cache that looks valid
+	const std::string temporaryPath = path + ".tmp";
+	std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+
+	MeshCacheFileHeader header;
+	std::memcpy(header.magic, meshCacheMagic, sizeof(meshCacheMagic));
+	header.version = MESH_CACHE_VERSION;
+	header.vertexSize = sizeof(Vertex);
+	header.materialSize = sizeof(Material);
+	header.meshCount = (uint32_t)meshes.size();
+	file.write((const char*)&header, sizeof(header));
+
+	const char padding[4] = { 0, 0, 0, 0 };
+	for (unsigned int i = 0; i < meshes.size(); i++) {
+		const MeshData& mesh = meshes[i];
+		MeshCacheMeshHeader meshHeader;
+		meshHeader.vertexCount = mesh.vertexCount;
+		meshHeader.indexCount = mesh.indexCount;
+		meshHeader.lodCount = (uint32_t)mesh.lods.size();
+		meshHeader.textureCount = (uint32_t)mesh.textures.size();
+		meshHeader.material = mesh.material;
+		file.write((const char*)&meshHeader, sizeof(meshHeader));
+		file.write((const char*)mesh.vertices, mesh.vertexCount * sizeof(Vertex));
+		file.write((const char*)mesh.indices, mesh.indexCount * sizeof(unsigned int));
+		if (!mesh.lods.empty())
+			file.write((const char*)mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+
+		for (unsigned int j = 0; j < mesh.textures.size(); j++) {
+			const string& type = mesh.textures[j].type;
+			const string& texturePath = mesh.textures[j].path;
+			uint32_t lengths[2] = { (uint32_t)type.size(), (uint32_t)texturePath.size() };
+			file.write((const char*)lengths, sizeof(lengths));
+			file.write(type.data(), type.size());
+			file.write(padding, paddedLength(lengths[0]) - lengths[0]);
+			file.write(texturePath.data(), texturePath.size());
+			file.write(padding, paddedLength(lengths[1]) - lengths[1]);
+		}
+	}
+	file.close();
+	if (!file) {
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	std::remove(path.c_str()); //rename does not overwrite an existing file on Windows
+	return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "MappedFile.hpp"
+#include "Mesh.hpp"
+
+// Bump this whenever the layout of the cache file or the processing of the meshes changes: older caches are then simply rebuilt from the source model
+// (2: meshes optimized by MeshOptimizer, 3: levels of detail from MeshSimplifier)
+#define MESH_CACHE_VERSION 3
+
+// Processed mesh data as it is stored in the cache: everything Model needs to build a Mesh without going through Assimp.
+// When read from the cache, the vertex and index arrays point straight into the mapped file and are only valid while it stays mapped.
+// Freshly imported meshes own their arrays instead (see setStorage). Move only, so that the arrays never point into another object
+struct MeshData {
+	const Vertex* vertices = nullptr;
+	unsigned int vertexCount = 0;
+	const unsigned int* indices = nullptr;
+	unsigned int indexCount = 0; //all the levels of detail, their index lists are stored back to back
+	vector<MeshLod> lods; //empty: the indices only make up the full mesh
+	vector<Texture> textures; //only type and path are stored, the GL ids are resolved by the Model when loading
+	Material material;
+
+	MeshData() = default;
+	MeshData(MeshData&&) = default;
+	MeshData& operator=(MeshData&&) = default;
+	MeshData(const MeshData&) = delete;
+	MeshData& operator=(const MeshData&) = delete;
+
+	// gives the mesh its own arrays (moving a vector keeps its buffer, so the pointers stay valid when the MeshData is moved)
+	void setStorage(vector<Vertex> newVertices, vector<unsigned int> newIndices) {
+		vertexStorage = std::move(newVertices);
+		indexStorage = std::move(newIndices);
+		vertices = vertexStorage.data();
+		vertexCount = (unsigned int)vertexStorage.size();
+		indices = indexStorage.data();
+		indexCount = (unsigned int)indexStorage.size();
+	}
+private:
+	vector<Vertex> vertexStorage;
+	vector<unsigned int> indexStorage;
+};
+
+// Versioned binary cache holding the processed meshes of a model, written next to the source file (e.g. Models/Stargate.obj.meshcache)
+// Layout: file header, then for each mesh a mesh header followed by its vertices, indices, levels of detail and texture references
+class MeshCache {
+public:
+	// Path of the cache file associated with a model file
+	static std::string cachePath(const std::string& modelPath);
+
+	// True if the cache of this model exists and is newer than the model file (and its .mtl if any)
+	static bool isUpToDate(const std::string& modelPath);
+
+	// Reads all the meshes from a mapped cache file without copying the vertex data. Returns false if the file is corrupted or from another version
+	static bool read(const MappedFile& file, vector<MeshData>& meshes);
+
+	// Writes the meshes of a model to a cache file. Returns false if the file could not be written
+	static bool write(const std::string& path, const vector<MeshData>& meshes);
+};
+
+#endif
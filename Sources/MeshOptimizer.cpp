@@ -0,0 +1,269 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+
+// vertices are compared bit for bit: only true duplicates are welded (the ones Assimp emits once per face corner)
+struct VertexBytesHash {
+	size_t operator()(const Vertex& vertex) const {
+		const unsigned char* bytes = (const unsigned char*)&vertex;
+		size_t hash = 2166136261u; //FNV-1a
+		for (size_t i = 0; i < sizeof(Vertex); i++) {
+			hash ^= bytes[i];
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+};
+
+struct VertexBytesEqual {
+	bool operator()(const Vertex& a, const Vertex& b) const {
+		return std::memcmp(&a, &b, sizeof(Vertex)) == 0;
+	}
+};
+
+void MeshOptimizer::optimize(vector<Vertex>& vertices, vector<unsigned int>& indices, const std::string& name) {
+	if (indices.size() < 3)
+		return;
+	const size_t originalVertexCount = vertices.size();
+	const float acmrBefore = computeACMR(indices, vertices.size());
+
+	weldVertices(vertices, indices);
+	optimizeVertexCache(indices, vertices.size());
+	optimizeOverdraw(indices, vertices);
+	optimizeVertexFetch(vertices, indices);
+
+	const float acmrAfter = computeACMR(indices, vertices.size());
+	cout << "MESHOPTIMIZER:: " << name << ": " << originalVertexCount << " -> " << vertices.size() << " vertices, ACMR "
+		<< acmrBefore << " -> " << acmrAfter << endl;
+}
+
+size_t MeshOptimizer::weldVertices(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	std::unordered_map<Vertex, unsigned int, VertexBytesHash, VertexBytesEqual> unique;
+	unique.reserve(vertices.size());
+	vector<unsigned int> remap(vertices.size());
+	vector<Vertex> welded;
+	welded.reserve(vertices.size());
+	for (unsigned int i = 0; i < vertices.size(); i++) {
+		std::pair<std::unordered_map<Vertex, unsigned int, VertexBytesHash, VertexBytesEqual>::iterator, bool> inserted =
+			unique.insert(std::make_pair(vertices[i], (unsigned int)welded.size()));
+		if (inserted.second)
+			welded.push_back(vertices[i]);
+		remap[i] = inserted.first->second;
+	}
+	for (unsigned int i = 0; i < indices.size(); i++)
+		indices[i] = remap[indices[i]];
+	vertices.swap(welded);
+	return vertices.size();
+}
+
+// Forsyth's scoring: the 3 most recent vertices get a fixed score (the triangle just drawn), then the score decreases with the
+// position in the cache. Vertices with few triangles left get a bonus so that they are finished off instead of leaving lone triangles
+static const int forsythCacheSize = 32;
+
+static float forsythVertexScore(int cachePosition, unsigned int remainingTriangles) {
+	if (remainingTriangles == 0)
+		return -1.0f;
+	float score = 0.0f;
+	if (cachePosition >= 0) {
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = powf(1.0f - (cachePosition - 3) * (1.0f / (forsythCacheSize - 3)), 1.5f);
+	}
+	return score + 2.0f * powf((float)remainingTriangles, -0.5f);
+}
+
+void MeshOptimizer::optimizeVertexCache(vector<unsigned int>& indices, size_t vertexCount) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	//triangles using each vertex, packed: the ones of vertex v are in adjacency[offsets[v], offsets[v] + remaining[v])
+	vector<unsigned int> remaining(vertexCount, 0);
+	for (unsigned int i = 0; i < triangleCount * 3; i++)
+		remaining[indices[i]]++;
+	vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + remaining[v];
+	vector<unsigned int> adjacency(triangleCount * 3);
+	vector<unsigned int> filled(vertexCount, 0);
+	for (unsigned int t = 0; t < triangleCount; t++)
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = indices[t * 3 + k];
+			adjacency[offsets[v] + filled[v]++] = t;
+		}
+
+	vector<int> cachePosition(vertexCount, -1);
+	vector<float> vertexScore(vertexCount);
+	for (unsigned int v = 0; v < vertexCount; v++)
+		vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+	vector<float> triangleScore(triangleCount);
+	vector<bool> emitted(triangleCount, false);
+	for (unsigned int t = 0; t < triangleCount; t++)
+		triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+	vector<unsigned int> output;
+	output.reserve(triangleCount * 3);
+	vector<unsigned int> cache, newCache;
+	unsigned int nextFallback = 0; //first triangle that may not be emitted yet, used when no triangle touches the cache
+	int best = -1;
+	for (unsigned int i = 0; i < triangleCount; i++) {
+		if (best < 0) {
+			while (emitted[nextFallback])
+				nextFallback++;
+			best = (int)nextFallback;
+		}
+		const unsigned int* triangle = &indices[best * 3];
+		output.insert(output.end(), triangle, triangle + 3);
+		emitted[best] = true;
+
+		//the triangle leaves the adjacency of its vertices
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = triangle[k];
+			unsigned int* begin = &adjacency[offsets[v]];
+			unsigned int* end = begin + remaining[v];
+			unsigned int* found = std::find(begin, end, (unsigned int)best);
+			*found = *(end - 1);
+			remaining[v]--;
+		}
+
+		//the vertices of the triangle go to the front of the cache
+		newCache.assign(triangle, triangle + 3);
+		for (unsigned int c = 0; c < cache.size(); c++)
+			if (cache[c] != triangle[0] && cache[c] != triangle[1] && cache[c] != triangle[2])
+				newCache.push_back(cache[c]);
+		cache.swap(newCache);
+
+		//rescores the vertices of the cache (and the ones just evicted) and the triangles around them, the best of those is next
+		for (unsigned int c = 0; c < cache.size(); c++) {
+			unsigned int v = cache[c];
+			cachePosition[v] = c < (unsigned int)forsythCacheSize ? (int)c : -1;
+			float newScore = forsythVertexScore(cachePosition[v], remaining[v]);
+			float delta = newScore - vertexScore[v];
+			vertexScore[v] = newScore;
+			for (unsigned int a = 0; a < remaining[v]; a++)
+				triangleScore[adjacency[offsets[v] + a]] += delta;
+		}
+		float bestScore = -1.0f;
+		best = -1;
+		for (unsigned int c = 0; c < cache.size() && c < (unsigned int)forsythCacheSize; c++) {
+			unsigned int v = cache[c];
+			for (unsigned int a = 0; a < remaining[v]; a++) {
+				unsigned int t = adjacency[offsets[v] + a];
+				if (triangleScore[t] > bestScore) {
+					bestScore = triangleScore[t];
+					best = (int)t;
+				}
+			}
+		}
+		if (cache.size() > (size_t)forsythCacheSize)
+			cache.resize(forsythCacheSize);
+	}
+	indices.swap(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(vector<unsigned int>& indices, const vector<Vertex>& vertices) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	//clusters start where the cache restarts (all 3 vertices miss): reordering them barely changes the ACMR
+	const unsigned int cacheSize = 16;
+	vector<unsigned int> cacheTime(vertices.size(), 0);
+	unsigned int timestamp = cacheSize + 1;
+	vector<unsigned int> clusterStarts;
+	for (unsigned int t = 0; t < triangleCount; t++) {
+		int misses = 0;
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = indices[t * 3 + k];
+			if (timestamp - cacheTime[v] > cacheSize) {
+				cacheTime[v] = timestamp++;
+				misses++;
+			}
+		}
+		if (t == 0 || misses == 3)
+			clusterStarts.push_back(t);
+	}
+	clusterStarts.push_back((unsigned int)triangleCount);
+	if (clusterStarts.size() <= 2)
+		return;
+
+	glm::vec3 meshCentroid(0.0f);
+	for (unsigned int i = 0; i < vertices.size(); i++)
+		meshCentroid += vertices[i].Position;
+	meshCentroid /= (float)vertices.size();
+
+	//occlusion potential of a cluster: how far out it is along its own normal, the most "outer" clusters are drawn first
+	struct Cluster {
+		unsigned int first, last;
+		float sortKey;
+	};
+	vector<Cluster> clusters;
+	for (unsigned int c = 0; c + 1 < clusterStarts.size(); c++) {
+		glm::vec3 centroid(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (unsigned int t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			const glm::vec3& a = vertices[indices[t * 3]].Position;
+			const glm::vec3& b = vertices[indices[t * 3 + 1]].Position;
+			const glm::vec3& d = vertices[indices[t * 3 + 2]].Position;
+			glm::vec3 cross = glm::cross(b - a, d - a); //length is twice the area
+			float triangleArea = glm::length(cross);
+			centroid += (a + b + d) * (triangleArea / 3.0f);
+			normal += cross;
+			area += triangleArea;
+		}
+		Cluster cluster;
+		cluster.first = clusterStarts[c];
+		cluster.last = clusterStarts[c + 1];
+		cluster.sortKey = 0.0f;
+		float normalLength = glm::length(normal);
+		if (area > 0.0f && normalLength > 0.0f)
+			cluster.sortKey = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+		clusters.push_back(cluster);
+	}
+	std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+	vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (unsigned int c = 0; c < clusters.size(); c++)
+		output.insert(output.end(), indices.begin() + clusters[c].first * 3, indices.begin() + clusters[c].last * 3);
+	indices.swap(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices) {
+	const unsigned int unused = ~0u;
+	vector<unsigned int> remap(vertices.size(), unused);
+	vector<Vertex> ordered;
+	ordered.reserve(vertices.size());
+	for (unsigned int i = 0; i < indices.size(); i++) {
+		unsigned int& newIndex = remap[indices[i]];
+		if (newIndex == unused) {
+			newIndex = (unsigned int)ordered.size();
+			ordered.push_back(vertices[indices[i]]);
+		}
+		indices[i] = newIndex;
+	}
+	vertices.swap(ordered); //vertices no triangle uses are dropped
+}
+
+float MeshOptimizer::computeACMR(const vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize) {
+	const size_t triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return 0.0f;
+	//FIFO emulation: a vertex is still in the cache if less than cacheSize misses happened since it was loaded
+	vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int timestamp = cacheSize + 1;
+	unsigned int misses = 0;
+	for (unsigned int i = 0; i < triangleCount * 3; i++) {
+		unsigned int v = indices[i];
+		if (timestamp - cacheTime[v] > cacheSize) {
+			cacheTime[v] = timestamp++;
+			misses++;
+		}
+	}
+	return (float)misses / triangleCount;
+}
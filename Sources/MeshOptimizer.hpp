@@ -0,0 +1,36 @@
+#pragma once
+
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <string>
+#include <vector>
+
+#include "Mesh.hpp"
+
+// Optimization pass run on the meshes right after the Assimp import (the result is what the mesh cache stores):
+// 1) duplicate vertices are welded, 2) triangles are reordered for the post-transform vertex cache (Forsyth),
+// 3) then by clusters for less overdraw, 4) vertices are reordered by first use for fetch locality
+class MeshOptimizer {
+public:
+	// Runs the whole pass and prints the statistics (vertex count and ACMR before and after) under the given name
+	static void optimize(vector<Vertex>& vertices, vector<unsigned int>& indices, const std::string& name);
+
+	// Merges the vertices with identical attributes and remaps the indices, returns the new vertex count
+	static size_t weldVertices(vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+	// Reorders the triangles so that consecutive triangles share vertices (Tom Forsyth's linear-speed vertex cache optimization)
+	static void optimizeVertexCache(vector<unsigned int>& indices, size_t vertexCount);
+
+	// Reorders clusters of triangles (cut where the vertex cache restarts) so that the ones facing outward are drawn first,
+	// which lets the depth test reject more of the fragments behind them. The order inside a cluster, and thus the ACMR, is kept
+	static void optimizeOverdraw(vector<unsigned int>& indices, const vector<Vertex>& vertices);
+
+	// Reorders the vertices in the order the indices first use them and remaps the indices
+	static void optimizeVertexFetch(vector<Vertex>& vertices, vector<unsigned int>& indices);
+
+	// Average cache miss ratio: transformed vertices per triangle with a FIFO cache of cacheSize entries (0.5 is ideal, 3 is the worst)
+	static float computeACMR(const vector<unsigned int>& indices, size_t vertexCount, unsigned int cacheSize = 16);
+};
+
+#endif
@@ -0,0 +1,132 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iostream>
+#include <unordered_map>
+
+#include "MeshOptimizer.hpp"
+
+// below this, a mesh is cheap enough to always be drawn in full
+static const size_t minTrianglesForLods = 256;
+
+// dominant axis of a normal (and its direction): vertices on both sides of a sharp edge or of a thin part stay apart
+static uint64_t normalBucket(const glm::vec3& normal) {
+	glm::vec3 a = glm::abs(normal);
+	if (a.x >= a.y && a.x >= a.z)
+		return normal.x >= 0.0f ? 0 : 1;
+	if (a.y >= a.z)
+		return normal.y >= 0.0f ? 2 : 3;
+	return normal.z >= 0.0f ? 4 : 5;
+}
+
+void MeshSimplifier::generateLods(const vector<Vertex>& vertices, vector<unsigned int>& indices, vector<MeshLod>& lods, const std::string& name) {
+	lods.clear();
+	MeshLod full;
+	full.indexOffset = 0;
+	full.indexCount = (unsigned int)indices.size();
+	full.error = 0.0f;
+	lods.push_back(full);
+	if (indices.size() < minTrianglesForLods * 3)
+		return;
+
+	//every level is simplified from the full mesh, from the finest grid to the coarsest
+	vector<unsigned int> levelIndices;
+	unsigned int previousCount = full.indexCount;
+	for (unsigned int resolution = 256; resolution >= 4 && lods.size() < maxLevels; resolution /= 2) {
+		float error = simplify(vertices, indices.data(), full.indexCount, resolution, levelIndices);
+		if (levelIndices.empty())
+			break;
+		//a level must drop a good part of the triangles of the previous one to be worth its memory and its switch
+		if (levelIndices.size() > previousCount * 6 / 10)
+			continue;
+		MeshOptimizer::optimizeVertexCache(levelIndices, vertices.size());
+		MeshLod lod;
+		lod.indexOffset = (unsigned int)indices.size();
+		lod.indexCount = (unsigned int)levelIndices.size();
+		lod.error = error;
+		indices.insert(indices.end(), levelIndices.begin(), levelIndices.end());
+		lods.push_back(lod);
+		previousCount = lod.indexCount;
+	}
+
+	cout << "MESHSIMPLIFIER:: " << name << ": LOD triangles";
+	for (unsigned int i = 0; i < lods.size(); i++)
+		cout << (i == 0 ? " " : " / ") << lods[i].indexCount / 3;
+	cout << endl;
+}
+
+float MeshSimplifier::simplify(const vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount, unsigned int gridResolution,
+	vector<unsigned int>& simplifiedIndices) {
+	simplifiedIndices.clear();
+	if (vertices.empty() || indexCount < 3)
+		return 0.0f;
+
+	glm::vec3 minimum = vertices[0].Position, maximum = vertices[0].Position;
+	for (unsigned int i = 1; i < vertices.size(); i++) {
+		minimum = glm::min(minimum, vertices[i].Position);
+		maximum = glm::max(maximum, vertices[i].Position);
+	}
+	glm::vec3 extent = maximum - minimum;
+	float cellSize = std::max(extent.x, std::max(extent.y, extent.z)) / gridResolution;
+	if (cellSize <= 0.0f)
+		return 0.0f;
+
+	//clusters: cell coordinates (20 bits each, gridResolution stays far below) and normal bucket packed in one key
+	std::unordered_map<uint64_t, unsigned int> clusterOfKey;
+	vector<unsigned int> vertexCluster(vertices.size());
+	vector<glm::vec3> clusterSum;
+	vector<unsigned int> clusterSize;
+	for (unsigned int i = 0; i < vertices.size(); i++) {
+		glm::vec3 cell = glm::min((vertices[i].Position - minimum) / cellSize, glm::vec3((float)gridResolution));
+		uint64_t key = (uint64_t)cell.x | ((uint64_t)cell.y << 20) | ((uint64_t)cell.z << 40) | (normalBucket(vertices[i].Normal) << 60);
+		std::pair<std::unordered_map<uint64_t, unsigned int>::iterator, bool> inserted =
+			clusterOfKey.insert(std::make_pair(key, (unsigned int)clusterSum.size()));
+		if (inserted.second) {
+			clusterSum.push_back(glm::vec3(0.0f));
+			clusterSize.push_back(0);
+		}
+		unsigned int cluster = inserted.first->second;
+		vertexCluster[i] = cluster;
+		clusterSum[cluster] += vertices[i].Position;
+		clusterSize[cluster]++;
+	}
+
+	//the representative of a cluster is its vertex closest to the mean: an existing vertex, so the VBO is shared by all the levels
+	const unsigned int none = ~0u;
+	vector<unsigned int> representative(clusterSum.size(), none);
+	vector<float> representativeDistance(clusterSum.size(), 0.0f);
+	for (unsigned int i = 0; i < vertices.size(); i++) {
+		unsigned int cluster = vertexCluster[i];
+		glm::vec3 difference = vertices[i].Position - clusterSum[cluster] / (float)clusterSize[cluster];
+		float distance = glm::dot(difference, difference);
+		if (representative[cluster] == none || distance < representativeDistance[cluster]) {
+			representative[cluster] = i;
+			representativeDistance[cluster] = distance;
+		}
+	}
+	float error = 0.0f;
+	for (unsigned int i = 0; i < vertices.size(); i++)
+		error = std::max(error, glm::length(vertices[i].Position - vertices[representative[vertexCluster[i]]].Position));
+
+	//triangles with 3 distinct clusters survive, rotated so that the smallest index comes first (keeps the winding) to remove the duplicates
+	vector<std::array<unsigned int, 3> > triangles;
+	triangles.reserve(indexCount / 3);
+	for (size_t t = 0; t + 2 < indexCount; t += 3) {
+		std::array<unsigned int, 3> triangle = { { representative[vertexCluster[indices[t]]], representative[vertexCluster[indices[t + 1]]],
+			representative[vertexCluster[indices[t + 2]]] } };
+		if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+			continue;
+		while (triangle[0] > triangle[1] || triangle[0] > triangle[2])
+			std::rotate(triangle.begin(), triangle.begin() + 1, triangle.end());
+		triangles.push_back(triangle);
+	}
+	std::sort(triangles.begin(), triangles.end());
+	triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+	simplifiedIndices.reserve(triangles.size() * 3);
+	for (unsigned int t = 0; t < triangles.size(); t++)
+		simplifiedIndices.insert(simplifiedIndices.end(), triangles[t].begin(), triangles[t].end());
+	return error;
+}
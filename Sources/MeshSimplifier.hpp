@@ -0,0 +1,39 @@
+#pragma once
+
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Mesh.hpp"
+
+// Generation of the levels of detail of a mesh, run at import time after MeshOptimizer (the result is stored in the mesh cache).
+// The levels only add indices: they reuse the vertices of the full mesh so that all of them are drawn from the same VBO
+class MeshSimplifier {
+public:
+	// Levels generated at most, the full mesh included
+	static const unsigned int maxLevels = 4;
+
+	// Appends the index lists of the simplified levels to indices and fills lods (lods[0] is the full mesh).
+	// Prints the triangle count of every level under the given name
+	static void generateLods(const vector<Vertex>& vertices, vector<unsigned int>& indices, vector<MeshLod>& lods, const std::string& name);
+
+	// Vertex clustering on a grid of gridResolution cells along the longest side of the bounding box: the vertices of a cell
+	// (with normals facing the same way) collapse on one of them and the triangles left with less than 3 distinct vertices disappear.
+	// Returns the error of the level, the largest distance a vertex may have moved (model space)
+	static float simplify(const vector<Vertex>& vertices, const unsigned int* indices, size_t indexCount, unsigned int gridResolution,
+		vector<unsigned int>& simplifiedIndices);
+
+	// Size on screen, in pixels, of one unit at a distance of one unit from the camera: the scale the errors of the levels are
+	// compared with. |projection[1][1]| = 1 / tan(fovy / 2), the absolute value as the application flips the image with a negative fovy
+	static float pixelScale(const glm::mat4& projection, float viewportHeight)
+	{
+		return std::abs(projection[1][1]) * 0.5f * viewportHeight;
+	}
+};
+
+#endif
@@ -4,7 +4,10 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
+#include <limits>
 #include <map>
+#include <memory>
 #include <vector>
 
 // GL Includes
@@ -15,8 +18,16 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "KtxTexture.hpp"
+#include "MappedFile.hpp"
 #include "Mesh.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
 #include "Shader.hpp"
+#include "TextureLoader.hpp"
+#include "TextureRegistry.hpp"
+#include "TextureStreamer.hpp"
 
 unsigned int TextureFromFile(const char* path, const string& directory, bool gamma = false);
 
@@ -24,33 +35,168 @@ class Model
 {
 public:
 	/*  Model Data */
-	vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+	vector<Texture> textures_loaded;	// every texture reference the model holds in the TextureRegistry (released by releaseTextures)
 	vector<Mesh> meshes;
 	string directory;
 	bool gammaCorrection;
+	bool packedVertices = false; // meshes uploaded in the quantized PackedVertex layout (set before upload(), the shaders must decode it)
+	glm::vec3 boundsCenter = glm::vec3(0.0f); // bounding sphere of all the meshes (model space), set by upload()
+	float boundsRadius = 0.0f;
+	vector<float> lodErrors; // error of each level of detail, the largest one of all the meshes (model space)
 
 	/*  Functions   */
-	// constructor, expects a filepath to a 3D model.
+	// constructor, expects a filepath to a 3D model. Loads and uploads the model right away
 	Model(string const& path, bool gamma = false) : gammaCorrection(gamma)
 	{
-		loadModel(path);
+		load(path);
+		upload();
 	}
 
 	Model() {//default constructor for global variable
 	}
 
-	// draws the model, and thus all its meshes
-	void Draw(Shader shader)
+	// first loading stage, CPU only so that it can run on a worker thread: reads the meshes (from the cache or through Assimp),
+	// reads the texture files they use and decodes them (unless they are going to be streamed). Nothing is visible before upload() is called on the GL thread
+	void load(string const& path, bool decodeTexturesNow = true)
+	{
+		loadModel(path);
+		readTextures(decodeTexturesNow);
+	}
+
+	// second loading stage, on the GL thread: creates the textures and the buffers of the meshes read by load().
+	// With a streamer, the textures not decoded by load() show a placeholder until the streamer uploaded them
+	void upload(TextureStreamer* streamer = nullptr)
+	{
+		textureStreamer = streamer;
+		for (unsigned int i = 0; i < pendingMeshes.size(); i++)
+		{
+			MeshData& data = pendingMeshes[i];
+			vector<Texture> textures;
+			for (unsigned int j = 0; j < data.textures.size(); j++)
+				textures.push_back(loadTexture(data.textures[j].path, data.textures[j].type));
+			// the arrays are uploaded as is to the VBO/EBO, straight from the mapped cache file or from the freshly imported data
+			meshes.push_back(Mesh(data.vertices, data.vertexCount, data.indices, data.indexCount, std::move(textures), data.material, data.lods, packedVertices));
+		}
+		computeBoundsAndLods();
+		// the driver has its own copy of everything now
+		vector<MeshData>().swap(pendingMeshes);
+		cacheFile.reset();
+		for (map<string, DecodedImage>::iterator it = decodedImages.begin(); it != decodedImages.end(); ++it)
+			freeImage(it->second);
+		decodedImages.clear();
+		encodedImages.clear();
+		textureStreamer = nullptr;
+	}
+
+	// full paths of the texture files used by the meshes read by load() (before upload())
+	vector<string> texturePaths() const
+	{
+		vector<string> paths;
+		for (unsigned int i = 0; i < pendingMeshes.size(); i++)
+		{
+			for (unsigned int j = 0; j < pendingMeshes[i].textures.size(); j++)
+			{
+				string path = directory + '/' + pendingMeshes[i].textures[j].path;
+				if (std::find(paths.begin(), paths.end(), path) == paths.end())
+					paths.push_back(path);
+			}
+		}
+		return paths;
+	}
+
+	// gives the textures of the model back to the TextureRegistry, the ones no other model uses are deleted
+	void releaseTextures()
+	{
+		for (unsigned int i = 0; i < textures_loaded.size(); i++)
+			TextureRegistry::instance().release(textures_loaded[i].id);
+		textures_loaded.clear();
+	}
+
+	// draws the model, and thus all its meshes, at the given level of detail (see selectLod)
+	void Draw(Shader& shader, unsigned int lod = 0)
 	{
 		for (unsigned int i = 0; i < meshes.size(); i++)
-			meshes[i].Draw(shader);
+			meshes[i].Draw(shader, lod);
+	}
+
+	// bounding sphere in world space, for that model matrix
+	void worldBounds(const glm::mat4& modelMatrix, glm::vec3& center, float& radius) const
+	{
+		center = glm::vec3(modelMatrix * glm::vec4(boundsCenter, 1.0f));
+		radius = boundsRadius * maxScale(modelMatrix);
+	}
+
+	// size on screen of one model space unit, in pixels, at the point of the bounding sphere closest to the camera
+	float pixelsPerUnit(const glm::mat4& modelMatrix, const glm::vec3& viewPos, const glm::mat4& projection, float viewportHeight) const
+	{
+		float scale = maxScale(modelMatrix);
+		glm::vec3 center = glm::vec3(modelMatrix * glm::vec4(boundsCenter, 1.0f));
+		float distance = glm::length(center - viewPos) - boundsRadius * scale;
+		if (distance <= 0.0f) // camera inside the bounding sphere
+			return std::numeric_limits<float>::max();
+		return scale * MeshSimplifier::pixelScale(projection, viewportHeight) / distance;
+	}
+
+	// coarsest level of detail whose error stays below maxPixelError pixels on screen
+	unsigned int selectLod(float pixelsPerUnit, float maxPixelError = 1.0f) const
+	{
+		unsigned int lod = 0;
+		while (lod + 1 < lodErrors.size() && lodErrors[lod + 1] * pixelsPerUnit <= maxPixelError)
+			lod++;
+		return lod;
 	}
 
 private:
+	/*  Loading state between load() and upload()  */
+	vector<MeshData> pendingMeshes;
+	std::shared_ptr<MappedFile> cacheFile; // keeps the cache mapped until the meshes are uploaded
+	map<string, EncodedImage> encodedImages; // texture files of the meshes read by load() but left to decode, by path
+	map<string, DecodedImage> decodedImages; // textures of the meshes decoded by load(), by path
+	TextureStreamer* textureStreamer = nullptr; // only set during upload()
+
 	/*  Functions   */
-	// loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+	// largest scale factor of the axes of a model matrix
+	static float maxScale(const glm::mat4& modelMatrix)
+	{
+		return glm::max(glm::length(glm::vec3(modelMatrix[0])), glm::max(glm::length(glm::vec3(modelMatrix[1])), glm::length(glm::vec3(modelMatrix[2]))));
+	}
+
+	// bounding sphere enclosing the ones of the meshes, and error of each level of detail over all the meshes
+	void computeBoundsAndLods()
+	{
+		boundsCenter = glm::vec3(0.0f);
+		boundsRadius = 0.0f;
+		lodErrors.clear();
+		if (meshes.empty())
+			return;
+		for (unsigned int i = 0; i < meshes.size(); i++)
+			boundsCenter += meshes[i].boundsCenter / (float)meshes.size();
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			boundsRadius = glm::max(boundsRadius, glm::length(meshes[i].boundsCenter - boundsCenter) + meshes[i].boundsRadius);
+			if (lodErrors.size() < meshes[i].lods.size())
+				lodErrors.resize(meshes[i].lods.size(), 0.0f);
+		}
+		// a mesh with less levels keeps drawing its coarsest one, which counts for the levels after it
+		for (unsigned int lod = 0; lod < lodErrors.size(); lod++)
+			for (unsigned int i = 0; i < meshes.size(); i++)
+				lodErrors[lod] = glm::max(lodErrors[lod], meshes[i].lod(lod).error);
+	}
+
+	// loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the pendingMeshes vector.
 	void loadModel(string const& path)
 	{
+		// retrieve the directory path of the filepath
+		directory = path.substr(0, path.find_last_of('/'));
+
+		// the binary cache holds the already processed meshes: when it is newer than the model file the whole Assimp import is skipped
+		if (MeshCache::isUpToDate(path))
+		{
+			if (loadFromCache(path))
+				return;
+			cout << "MESHCACHE:: invalid cache, importing the model again: " << path << endl;
+		}
+
 		// read file via ASSIMP
 		Assimp::Importer importer;
 		const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
@@ -60,11 +206,51 @@ private:
 			cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
 			return;
 		}
-		// retrieve the directory path of the filepath
-		directory = path.substr(0, path.find_last_of('/'));
 
 		// process ASSIMP's root node recursively
 		processNode(scene->mRootNode, scene);
+
+		// store the processed meshes so that the next launches don't have to go through Assimp again
+		if (!MeshCache::write(MeshCache::cachePath(path), pendingMeshes))
+			cout << "ERROR::MESHCACHE:: could not write the cache of " << path << endl;
+	}
+
+	// reads the meshes from the binary cache of the model, returns false if the cache could not be read.
+	// The cache file is memory mapped and stays mapped until upload(): no copy of the vertex data is made
+	bool loadFromCache(string const& path)
+	{
+		cacheFile = std::make_shared<MappedFile>();
+		if (!cacheFile->open(MeshCache::cachePath(path)) || !MeshCache::read(*cacheFile, pendingMeshes))
+		{
+			pendingMeshes.clear();
+			cacheFile.reset();
+			return false;
+		}
+		cout << "Model loaded from cache: " << path << endl;
+		return true;
+	}
+
+	// reads (and decodes if asked) every texture file referenced by the pending meshes, once per path
+	void readTextures(bool decode)
+	{
+		for (unsigned int i = 0; i < pendingMeshes.size(); i++)
+		{
+			for (unsigned int j = 0; j < pendingMeshes[i].textures.size(); j++)
+			{
+				const string& path = pendingMeshes[i].textures[j].path;
+				if (encodedImages.find(path) != encodedImages.end() || decodedImages.find(path) != decodedImages.end())
+					continue;
+				// a baked texture is uploaded straight from its file by the registry, nothing to prepare here
+				string fullPath = directory + '/' + path;
+				if (KtxTexture::isUpToDate(KtxTexture::bakedPath(fullPath), vector<string>(1, fullPath)))
+					continue;
+				EncodedImage file = readImageFile(fullPath);
+				if (decode)
+					decodedImages[path] = decodeImage(file);
+				else
+					encodedImages[path] = std::move(file);
+			}
+		}
 	}
 
 	// processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -76,7 +262,7 @@ private:
 			// the node object only contains indices to index the actual objects in the scene. 
 			// the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
 			aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-			meshes.push_back(processMesh(mesh, scene));
+			pendingMeshes.push_back(processMesh(mesh, scene));
 		}
 		// after we've processed all of the meshes (if any) we then recursively process each of the children nodes
 		for (unsigned int i = 0; i < node->mNumChildren; i++)
@@ -86,12 +272,14 @@ private:
 
 	}
 
-	Mesh processMesh(aiMesh* mesh, const aiScene* scene)
+	MeshData processMesh(aiMesh* mesh, const aiScene* scene)
 	{
 		// data to fill
 		vector<Vertex> vertices;
 		vector<unsigned int> indices;
 		vector<Texture> textures;
+		vertices.reserve(mesh->mNumVertices);
+		indices.reserve(mesh->mNumFaces * 3); // faces are triangulated by Assimp
 
 		// Walk through each of the mesh's vertices
 		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -146,6 +334,12 @@ private:
 			for (unsigned int j = 0; j < face.mNumIndices; j++)
 				indices.push_back(face.mIndices[j]);
 		}
+		// weld the duplicated vertices and reorder for the vertex cache, overdraw and vertex fetch (stored as such in the mesh cache)
+		MeshOptimizer::optimize(vertices, indices, directory + '/' + mesh->mName.C_Str());
+		// simplified levels of detail, appended to the indices
+		vector<MeshLod> lods;
+		MeshSimplifier::generateLods(vertices, indices, lods, directory + '/' + mesh->mName.C_Str());
+
 		// process materials
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
 		// we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -155,7 +349,7 @@ private:
 		// specular: texture_specularN
 		// normal: texture_normalN
 
-		// 1. diffuse maps
+		// 1. diffuse maps (only referenced here, they are loaded with the rest of the model)
 		vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
 		textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
 		// 2. specular maps
@@ -171,13 +365,17 @@ private:
 		std::vector<Texture> emissionMaps = loadMaterialTextures(material, aiTextureType_EMISSIVE, "texture_emission");
 		textures.insert(textures.end(), emissionMaps.begin(), emissionMaps.end());
 
-		Material materialProperties = loadMaterial(material);
-		// return a mesh object created from the extracted mesh data
-		return Mesh(vertices, indices, textures, materialProperties);
+		// return the extracted mesh data, it owns its arrays until they are uploaded
+		MeshData data;
+		data.setStorage(std::move(vertices), std::move(indices));
+		data.lods = std::move(lods);
+		data.textures = std::move(textures);
+		data.material = loadMaterial(material);
+		return data;
 	}
 
-	// checks all material textures of a given type and loads the textures if they're not loaded yet.
-	// the required info is returned as a Texture struct.
+	// lists all material textures of a given type.
+	// the required info is returned as Texture structs, their ids are set once the textures are loaded in upload().
 	vector<Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, string typeName)
 	{
 		vector<Texture> textures;
@@ -185,30 +383,47 @@ private:
 		{
 			aiString str;
 			mat->GetTexture(type, i, &str);
-			// check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-			bool skip = false;
-			for (unsigned int j = 0; j < textures_loaded.size(); j++)
-			{
-				if (std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-				{
-					textures.push_back(textures_loaded[j]);
-					skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-					break;
-				}
-			}
-			if (!skip)
-			{   // if texture hasn't been loaded already, load it
-				Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
-				texture.type = typeName;
-				texture.path = str.C_Str();
-				textures.push_back(texture);
-				textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-			}
+			Texture texture;
+			texture.id = 0;
+			texture.type = typeName;
+			texture.path = str.C_Str();
+			textures.push_back(texture);
 		}
 		return textures;
 	}
 
+	// gets a texture of the model from the TextureRegistry: it is only loaded if no mesh of any model uses the same path or the same image
+	Texture loadTexture(string const& path, string const& typeName)
+	{
+		TextureRegistry& registry = TextureRegistry::instance();
+		Texture texture;
+		map<string, DecodedImage>::iterator decoded = decodedImages.find(path);
+		map<string, EncodedImage>::iterator encoded = encodedImages.find(path);
+		if (decoded != decodedImages.end())
+			texture.id = registry.acquire2D(decoded->second);
+		else if (encoded != encodedImages.end())
+		{
+			texture.id = registry.acquire2D(std::move(encoded->second), textureStreamer, placeholderColor(typeName));
+			encodedImages.erase(encoded); // the next references to this path are found by path in the registry
+		}
+		else
+			texture.id = registry.acquire2D(directory + '/' + path, textureStreamer, placeholderColor(typeName));
+		texture.type = typeName;
+		texture.path = path;
+		textures_loaded.push_back(texture);  // one entry per reference taken, see releaseTextures
+		return texture;
+	}
+
+	// color shown by a streamed texture until its image is uploaded: neutral for the lighting terms it feeds
+	static glm::vec4 placeholderColor(string const& typeName)
+	{
+		if (typeName == "texture_normal")
+			return glm::vec4(0.5f, 0.5f, 1.0f, 1.0f); // flat tangent space normal
+		if (typeName == "texture_emission" || typeName == "texture_specular")
+			return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		return glm::vec4(0.5f, 0.5f, 0.5f, 1.0f);
+	}
+
 	Material loadMaterial(aiMaterial* mat) {
 		Material material;
 		aiColor3D color(0.f, 0.f, 0.f);
@@ -236,41 +451,5 @@ private:
 
 unsigned int TextureFromFile(const char* path, const string& directory, bool gamma)
 {
-	string filename = string(path);
-	filename = directory + '/' + filename;
-
-	unsigned int textureID;
-	glGenTextures(1, &textureID);
-
-	int width, height, nrComponents;
-	unsigned char* data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format{};
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(data);
-		cout << "Texture loaded at path: " << filename << std::endl;
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << filename << std::endl;
-		stbi_image_free(data);
-	}
-
-	return textureID;
+	return TextureRegistry::instance().acquire2D(directory + '/' + string(path));
 }
@@ -0,0 +1,110 @@
+#include "OrbitingInstances.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <future>
+
+static const unsigned int chunkSize = 16384; //instances per task, smaller sets are updated on the calling thread
+static const double twoPi = 6.283185307179586;
+
+void OrbitingInstances::setBands(const glm::vec3& center, float referenceRadius, float referenceSpeed, float minRadius, float maxRadius, unsigned int bandCount, float maxSpin) {
+	mCenter = center;
+	mBandCount = std::min(std::max(bandCount, 1u), orbitBands);
+	mMinRadius = minRadius;
+	mBandWidth = std::max(maxRadius - minRadius, 1e-3f) / mBandCount;
+	mMaxSpin = maxSpin;
+	for (unsigned int band = 0; band < mBandCount; band++) {
+		const double radius = std::max(minRadius + (band + 0.5) * mBandWidth, 1e-3);
+		mOrbitSpeeds[band] = referenceSpeed * std::pow(referenceRadius / radius, 1.5);
+	}
+	for (unsigned int band = 0; band < spinBands; band++)
+		mSpinSpeeds[band] = maxSpin * band / (spinBands - 1);
+}
+
+unsigned int OrbitingInstances::append(const InstanceTransform* instances, const Spin* spins, unsigned int count, int orbitBand) {
+	const unsigned int first = (unsigned int)mOrbits.size();
+	mOrbits.resize(first + count);
+	for (unsigned int i = 0; i < count; i++) {
+		const glm::vec3 offset = instances[i].position() - mCenter;
+		Orbit& orbit = mOrbits[first + i];
+		orbit.initialRotation = instances[i].rotation;
+		orbit.spinAxis = spins[i].axis;
+		orbit.offsetX = offset.x;
+		orbit.offsetZ = offset.z;
+		orbit.y = instances[i].positionScale.y;
+		orbit.scale = instances[i].scale();
+		if (orbitBand >= 0)
+			orbit.orbitBand = (uint16_t)std::min((unsigned int)orbitBand, mBandCount - 1);
+		else {
+			const float radius = glm::length(glm::vec2(offset.x, offset.z));
+			orbit.orbitBand = (uint16_t)std::min((unsigned int)std::max((radius - mMinRadius) / mBandWidth, 0.0f), mBandCount - 1);
+		}
+		orbit.spinBand = mMaxSpin > 0.0f ? (uint16_t)std::min((unsigned int)(spins[i].speed / mMaxSpin * (spinBands - 1) + 0.5f), spinBands - 1) : 0;
+	}
+	return first;
+}
+
+void OrbitingInstances::erase(unsigned int first, unsigned int count) {
+	mOrbits.erase(mOrbits.begin() + first, mOrbits.begin() + first + count);
+}
+
+glm::vec3 OrbitingInstances::orbitPosition(const glm::vec3& position, unsigned int orbitBand, double time) const {
+	//same rotation as updateRange
+	const double angle = std::fmod(mOrbitSpeeds[orbitBand] * time, twoPi);
+	const float c = (float)std::cos(angle), s = (float)std::sin(angle);
+	const glm::vec3 offset = position - mCenter;
+	return glm::vec3(mCenter.x + offset.x * c + offset.z * s, position.y, mCenter.z + offset.z * c - offset.x * s);
+}
+
+void OrbitingInstances::update(double time, InstanceTransform* out, ThreadPool* pool) const {
+	//angles in double and wrapped, the float ones would lose their precision as the time grows
+	glm::vec2 orbitAngles[orbitBands];
+	for (unsigned int band = 0; band < mBandCount; band++) {
+		const double angle = std::fmod(mOrbitSpeeds[band] * time, twoPi);
+		orbitAngles[band] = glm::vec2((float)std::cos(angle), (float)std::sin(angle));
+	}
+	glm::vec2 spinHalfAngles[spinBands];
+	for (unsigned int band = 0; band < spinBands; band++) {
+		const double halfAngle = std::fmod(mSpinSpeeds[band] * time, twoPi) * 0.5;
+		spinHalfAngles[band] = glm::vec2((float)std::cos(halfAngle), (float)std::sin(halfAngle));
+	}
+
+	const unsigned int count = instanceCount();
+	if (pool == nullptr || count <= chunkSize) {
+		updateRange(0, count, orbitAngles, spinHalfAngles, out);
+		return;
+	}
+	//the first chunk on this thread while the workers take the others
+	std::vector<std::future<void>> chunks;
+	for (unsigned int first = chunkSize; first < count; first += chunkSize) {
+		const unsigned int end = std::min(first + chunkSize, count);
+		chunks.push_back(pool->submit([this, first, end, &orbitAngles, &spinHalfAngles, out]() {
+			updateRange(first, end, orbitAngles, spinHalfAngles, out);
+		}));
+	}
+	updateRange(0, chunkSize, orbitAngles, spinHalfAngles, out);
+	for (std::future<void>& chunk : chunks)
+		chunk.get();
+}
+
+void OrbitingInstances::updateRange(unsigned int first, unsigned int end, const glm::vec2* orbitAngles, const glm::vec2* spinHalfAngles, InstanceTransform* out) const {
+	for (unsigned int i = first; i < end; i++) {
+		const Orbit& orbit = mOrbits[i];
+		//orbit: rotation of the offset around the y axis
+		const glm::vec2 orbitAngle = orbitAngles[orbit.orbitBand];
+		const float x = orbit.offsetX * orbitAngle.x + orbit.offsetZ * orbitAngle.y;
+		const float z = orbit.offsetZ * orbitAngle.x - orbit.offsetX * orbitAngle.y;
+		out[i].positionScale = glm::vec4(mCenter.x + x, orbit.y, mCenter.z + z, orbit.scale);
+
+		//tumble: spin quaternion (axis * sin, cos) times the initial rotation
+		const glm::vec2 half = spinHalfAngles[orbit.spinBand];
+		const glm::vec3 s = orbit.spinAxis * half.y;
+		const float c = half.x;
+		const glm::vec4& q = orbit.initialRotation;
+		out[i].rotation = glm::vec4(
+			c * q.x + s.x * q.w + s.y * q.z - s.z * q.y,
+			c * q.y - s.x * q.z + s.y * q.w + s.z * q.x,
+			c * q.z + s.x * q.y - s.y * q.x + s.z * q.w,
+			c * q.w - s.x * q.x - s.y * q.y - s.z * q.z);
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#ifndef ORBITING_INSTANCES_H
+#define ORBITING_INSTANCES_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "InstanceTransform.hpp"
+#include "ThreadPool.hpp"
+
+// Instances on circular orbits around the y axis of a center, each tumbling around its own axis (the asteroid ring).
+// The angular speeds are quantized in bands (orbits: Keplerian speed of the band's radius, spins: evenly spread up to the
+// fastest one), so that the sines and cosines are computed once per band and frame: updating an instance is a 2D rotation
+// and a quaternion product, without trigonometry. Large sets are updated in chunks on a thread pool.
+// Instances come and go (append, erase) as the parts of the ring near the camera are streamed in and out
+class OrbitingInstances {
+public:
+	static const unsigned int orbitBands = 256;
+	static const unsigned int spinBands = 64;
+
+	// Tumble of an instance: unit axis, radians per second
+	struct Spin {
+		glm::vec3 axis;
+		float speed;
+	};
+
+	// Band layout: bandCount orbit bands evenly over [minRadius, maxRadius] around the y axis of center, an orbit of radius
+	// referenceRadius goes at referenceSpeed (radians per second), the others at referenceSpeed * (referenceRadius / radius)^1.5.
+	// The spin bands go up to maxSpin. Set before adding instances
+	void setBands(const glm::vec3& center, float referenceRadius, float referenceSpeed, float minRadius, float maxRadius, unsigned int bandCount, float maxSpin);
+
+	// Adds count instances in their transform at time 0 and their spins after the others, returns the index of the first.
+	// orbitBand puts them all on one band (they orbit as a block), -1 picks the band of each from its radius
+	unsigned int append(const InstanceTransform* instances, const Spin* spins, unsigned int count, int orbitBand = -1);
+
+	// Removes the instances [first, first + count), the next ones move down
+	void erase(unsigned int first, unsigned int count);
+
+	// Writes the transforms at time (seconds) of every instance in out, chunks run on pool (nullptr: all on this thread)
+	void update(double time, InstanceTransform* out, ThreadPool* pool) const;
+
+	// Position at time (seconds) of a point at position at time 0 on orbitBand
+	glm::vec3 orbitPosition(const glm::vec3& position, unsigned int orbitBand, double time) const;
+
+	unsigned int instanceCount() const { return (unsigned int)mOrbits.size(); }
+
+private:
+	struct Orbit {
+		glm::vec4 initialRotation; // quaternion (x, y, z, w) at time 0
+		glm::vec3 spinAxis;
+		float offsetX, offsetZ; // from the center, at time 0
+		float y;
+		float scale;
+		uint16_t orbitBand;
+		uint16_t spinBand;
+	};
+
+	// instances [first, end) at the band angles (cosine, sine) of the frame
+	void updateRange(unsigned int first, unsigned int end, const glm::vec2* orbitAngles, const glm::vec2* spinHalfAngles, InstanceTransform* out) const;
+
+	glm::vec3 mCenter = glm::vec3(0.0f);
+	unsigned int mBandCount = 1;
+	float mMinRadius = 0.0f;
+	float mBandWidth = 1.0f;
+	float mMaxSpin = 0.0f;
+	std::vector<Orbit> mOrbits;
+	double mOrbitSpeeds[orbitBands] = { 0.0 }; // radians per second
+	double mSpinSpeeds[spinBands] = { 0.0 };
+};
+
+#endif
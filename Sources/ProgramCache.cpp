@@ -0,0 +1,137 @@
+#include "ProgramCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+static const char programCacheDirectory[] = "ShaderCache";
+static const char programCacheMagic[4] = { 'S', 'G', 'P', 'B' };
+
+// On-disk header, followed by the binary itself
+struct ProgramCacheHeader {
+	char magic[4];
+	uint32_t version;
+	uint64_t key;
+	uint32_t binaryFormat;
+	uint32_t binaryLength;
+};
+
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) { //FNV-1a
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static std::string glString(GLenum name) {
+	const GLubyte* value = glGetString(name);
+	return value ? std::string((const char*)value) : std::string();
+}
+
+static void createDirectory(const char* path) {
+#ifdef _WIN32
+	_mkdir(path);
+#else
+	mkdir(path, 0755);
+#endif
+}
+
+bool ProgramCache::isSupported() {
+	if (!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary)
+		return false;
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	return formatCount > 0;
+}
+
+uint64_t ProgramCache::key(const std::vector<ShaderStageSource>& stages, const std::vector<std::string>& feedbackVaryings, GLenum feedbackMode) {
+	//the binaries are only valid for the driver that produced them
+	static const std::string driver = glString(GL_VENDOR) + '\n' + glString(GL_RENDERER) + '\n' + glString(GL_VERSION);
+	uint64_t hash = 14695981039346656037ull;
+	const uint32_t version = PROGRAM_CACHE_VERSION;
+	hash = hashBytes(hash, &version, sizeof(version));
+	hash = hashBytes(hash, driver.data(), driver.size());
+	for (unsigned int i = 0; i < stages.size(); i++) {
+		const uint64_t header[2] = { stages[i].type, stages[i].code.size() }; //the sizes keep the stages from blending into each other
+		hash = hashBytes(hash, header, sizeof(header));
+		hash = hashBytes(hash, stages[i].code.data(), stages[i].code.size());
+	}
+	//the varyings change the linked program without changing any source
+	const uint64_t feedback[2] = { feedbackVaryings.size(), feedbackVaryings.empty() ? 0 : feedbackMode };
+	hash = hashBytes(hash, feedback, sizeof(feedback));
+	for (const std::string& varying : feedbackVaryings)
+		hash = hashBytes(hash, varying.c_str(), varying.size() + 1); //with the terminator, names cannot blend either
+	return hash;
+}
+
+std::string ProgramCache::cachePath(uint64_t key) {
+	char name[32];
+	std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return std::string(programCacheDirectory) + '/' + name;
+}
+
+bool ProgramCache::load(GLuint program, uint64_t key) {
+	std::ifstream file(cachePath(key), std::ios::binary);
+	if (!file.is_open())
+		return false;
+	std::vector<char> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	ProgramCacheHeader header;
+	if (content.size() < sizeof(header))
+		return false;
+	std::memcpy(&header, content.data(), sizeof(header));
+	if (std::memcmp(header.magic, programCacheMagic, sizeof(programCacheMagic)) != 0 || header.version != PROGRAM_CACHE_VERSION
+		|| header.key != key || content.size() - sizeof(header) != header.binaryLength)
+		return false;
+
+	glProgramBinary(program, header.binaryFormat, content.data() + sizeof(header), header.binaryLength);
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	return linked == GL_TRUE; //drivers may reject their own binaries (e.g. after a settings change), not an error
+}
+
+bool ProgramCache::store(GLuint program, uint64_t key) {
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return false;
+	std::vector<char> binary(length);
+	GLenum binaryFormat = 0;
+	GLsizei written = 0;
+	glGetProgramBinary(program, length, &written, &binaryFormat, binary.data());
+	if (written <= 0)
+		return false;
+
+	ProgramCacheHeader header;
+	std::memcpy(header.magic, programCacheMagic, sizeof(programCacheMagic));
+	header.version = PROGRAM_CACHE_VERSION;
+	header.key = key;
+	header.binaryFormat = binaryFormat;
+	header.binaryLength = (uint32_t)written;
+
+	//written to a temporary file first so that a crash while writing never leaves a truncated binary that looks valid
+	createDirectory(programCacheDirectory);
+	const std::string path = cachePath(key);
+	const std::string temporaryPath = path + ".tmp";
+	std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+		return false;
+	file.write((const char*)&header, sizeof(header));
+	file.write(binary.data(), written);
+	file.close();
+	if (!file) {
+		std::remove(temporaryPath.c_str());
+		return false;
+	}
+	std::remove(path.c_str()); //rename does not overwrite an existing file on Windows
+	return std::rename(temporaryPath.c_str(), path.c_str()) == 0;
+}
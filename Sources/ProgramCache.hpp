@@ -0,0 +1,45 @@
+#pragma once
+
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Bump this whenever the layout of the cache files changes: older files are then simply ignored and rewritten
+#define PROGRAM_CACHE_VERSION 1
+
+// One stage of a program as it is handed to the driver (the key of a program is computed from these)
+struct ShaderStageSource {
+	GLenum type;
+	std::string code;
+	std::vector<std::string> files; //the stage's file then its included files, in source string order (not part of the key)
+};
+
+// Disk cache of linked programs (glGetProgramBinary) in the ShaderCache directory, one file per program named after its key.
+// The key hashes the sources of all the stages and the state set before linking (transform feedback varyings) together with
+// the driver identification: a driver update, an edited shader or other varyings simply miss the cache and the program is
+// compiled again
+class ProgramCache {
+public:
+	// True if the driver can give program binaries back (GL 4.1 or ARB_get_program_binary, with at least one binary format)
+	static bool isSupported();
+
+	// Key of the program made of these stages, capturing feedbackVaryings in feedbackMode (none: empty), on the current driver
+	static uint64_t key(const std::vector<ShaderStageSource>& stages, const std::vector<std::string>& feedbackVaryings, GLenum feedbackMode);
+
+	// Path of the cache file of a key
+	static std::string cachePath(uint64_t key);
+
+	// Loads the cached binary of the key into the program, returns false if there is none or the driver rejected it
+	// (the program can then be built from its sources as usual)
+	static bool load(GLuint program, uint64_t key);
+
+	// Writes the binary of a linked program (created with GL_PROGRAM_BINARY_RETRIEVABLE_HINT) to the cache
+	static bool store(GLuint program, uint64_t key);
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "SceneUniforms.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "LightCulling.hpp"
+#include "Shader.hpp"
+
+void SceneUniforms::create(bool clustered) {
+	glGenBuffers(1, &frameBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameBlock), NULL, GL_DYNAMIC_DRAW);
+	glBindBufferBase(GL_UNIFORM_BUFFER, frameBinding, frameBuffer);
+
+	GLint alignment = 1;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment = std::max(alignment, 1);
+	lightSlotSize = ((GLsizeiptr)sizeof(LightBlock) + alignment - 1) / alignment * alignment;
+	glGenBuffers(1, &lightBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, lightSlotSize * lightSlots, NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	bindLightSlot(0);
+
+	Shader::setUniformBlockBinding("FrameData", frameBinding);
+	Shader::setUniformBlockBinding("LightData", lightBinding);
+
+	//the resources of the clusters are created whenever the driver supports them, so that the lighting can switch at runtime
+	mClusterResources = clusteredSupported();
+	if (mClusterResources) {
+		glGenBuffers(1, &clusterBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, clusterBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(ClusterBlock), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, clusterBinding, clusterBuffer);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		Shader::setUniformBlockBinding("ClusterData", clusterBinding);
+
+		//the texture buffers stay bound to their units, the programs get the units when they are linked
+		createTextureBuffer(lightTexelUnit, GL_RGBA32F, lightTexelBuffer, lightTexelTexture);
+		createTextureBuffer(clusterRangeUnit, GL_RG32UI, clusterRangeBuffer, clusterRangeTexture);
+		createTextureBuffer(clusterIndexUnit, GL_R16UI, clusterIndexBuffer, clusterIndexTexture);
+		Shader::setSamplerBinding("lightTexels", lightTexelUnit);
+		Shader::setSamplerBinding("clusterRanges", clusterRangeUnit);
+		Shader::setSamplerBinding("clusterLightIndices", clusterIndexUnit);
+	}
+	setClustered(clustered);
+}
+
+bool SceneUniforms::clusteredSupported() {
+	GLint fragmentUnits = 0, combinedUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &fragmentUnits);
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &combinedUnits);
+	const GLint needed = (GLint)std::max(std::max(lightTexelUnit, clusterRangeUnit), clusterIndexUnit) + 1;
+	return fragmentUnits >= needed && combinedUnits >= needed;
+}
+
+void SceneUniforms::setClustered(bool clustered) {
+	if (clustered && !mClusterResources)
+		std::cout << "| ERROR::SCENE_UNIFORMS: not enough texture units for clustered lighting, the per object light lists are used" << std::endl;
+	mClustered = clustered && mClusterResources;
+	if (!mClustered)
+		bindLightSlot(0); //until the next updateLights fills the lists
+}
+
+void SceneUniforms::createTextureBuffer(GLuint unit, GLenum format, GLuint& buffer, GLuint& texture) {
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_DYNAMIC_DRAW);
+	glGenTextures(1, &texture);
+	glActiveTexture(GL_TEXTURE0 + unit);
+	glBindTexture(GL_TEXTURE_BUFFER, texture);
+	glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+	glActiveTexture(GL_TEXTURE0);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void SceneUniforms::uploadTextureBuffer(GLuint buffer, GLsizeiptr size, const void* data) {
+	glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+	glBufferData(GL_TEXTURE_BUFFER, std::max<GLsizeiptr>(size, 16), NULL, GL_DYNAMIC_DRAW); //new storage, the previous view may still read the old one
+	if (size > 0)
+		glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+void SceneUniforms::updateFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos, float farPlane) {
+	FrameBlock block;
+	block.view = view;
+	block.projection = projection;
+	block.viewPos = viewPos;
+	block.farPlane = farPlane;
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	if (mClustered)
+		updateClusters(view, projection);
+}
+
+void SceneUniforms::updateClusters(const glm::mat4& view, const glm::mat4& projection) {
+	mClusters.build(mLights, mInfluenceRadii, view, projection);
+	uploadTextureBuffer(clusterRangeBuffer, mClusters.ranges().size() * sizeof(glm::uvec2), mClusters.ranges().data());
+	uploadTextureBuffer(clusterIndexBuffer, mClusters.indices().size() * sizeof(uint16_t), mClusters.indices().data());
+
+	ClusterBlock block;
+	block.grid = glm::ivec4(LightClusters::tilesX, LightClusters::tilesY, LightClusters::depthSlices, mSunIndex);
+	block.depth = glm::vec4(mClusters.nearPlane(), mClusters.farPlane(), mClusters.sliceScale(), mClusters.sliceBias());
+	glBindBuffer(GL_UNIFORM_BUFFER, clusterBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(block), &block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void SceneUniforms::updateLights(const std::vector<LightSource*>& lights, const LightSource* shadowCaster) {
+	mLights = lights;
+	mShadowCaster = shadowCaster;
+	mInfluenceRadii.resize(lights.size());
+	for (unsigned int i = 0; i < lights.size(); i++)
+		mInfluenceRadii[i] = LightCulling::influenceRadius(*lights[i]);
+
+	if (mClustered) { //every light, the clusters of each view index them
+		mSunIndex = -1;
+		mLightTexels.resize(lights.size());
+		for (unsigned int i = 0; i < lights.size(); i++) {
+			mLightTexels[i] = lightEntry(*lights[i]);
+			if (lights[i] == shadowCaster)
+				mSunIndex = (GLint)i;
+		}
+		uploadTextureBuffer(lightTexelBuffer, mLightTexels.size() * sizeof(LightBlockEntry), mLightTexels.data());
+		return;
+	}
+
+	//new storage for the frame: the lists of the previous frame may still be read by the GPU
+	glBindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, lightSlotSize * lightSlots, NULL, GL_DYNAMIC_DRAW);
+	mNextLightSlot = 1;
+
+	mSelected.clear();
+	for (int i = 0; i < (int)std::min<size_t>(lights.size(), maxLights); i++)
+		mSelected.push_back(i);
+	writeLightSlot(0, mSelected);
+	bindLightSlot(0);
+}
+
+void SceneUniforms::bindLightsFor(const glm::vec3& center, float radius) {
+	if (mClustered) //the fragments find their lights in their cluster
+		return;
+	if (mNextLightSlot >= lightSlots) {
+		bindLightSlot(0);
+		return;
+	}
+	LightCulling::select(mLights, mInfluenceRadii, center, radius, maxLights, mSelected, mCandidates);
+	glBindBuffer(GL_UNIFORM_BUFFER, lightBuffer);
+	writeLightSlot(mNextLightSlot, mSelected);
+	bindLightSlot(mNextLightSlot);
+	mNextLightSlot++;
+}
+
+void SceneUniforms::writeLightSlot(int slot, const std::vector<int>& selected) {
+	LightBlock block;
+	std::memset(&block, 0, sizeof(block));
+	block.lightCounter = (GLint)selected.size();
+	block.sunLight = -1;
+	for (int i = 0; i < block.lightCounter; i++) {
+		const LightSource& light = *mLights[selected[i]];
+		block.light[i] = lightEntry(light);
+		if (&light == mShadowCaster)
+			block.sunLight = i;
+	}
+	glBufferSubData(GL_UNIFORM_BUFFER, slot * lightSlotSize, sizeof(block), &block);
+}
+
+void SceneUniforms::bindLightSlot(int slot) {
+	glBindBufferRange(GL_UNIFORM_BUFFER, lightBinding, lightBuffer, slot * lightSlotSize, sizeof(LightBlock));
+}
+
+LightBlockEntry SceneUniforms::lightEntry(const LightSource& light) {
+	LightBlockEntry entry;
+	std::memset(&entry, 0, sizeof(entry));
+	entry.position = light.Position;
+	entry.ambient = light.Ambient;
+	entry.spotlight = light.SpotlightBool;
+	entry.diffuse = light.Diffuse;
+	entry.attenuationBool = light.AttenuationBool;
+	entry.specular = light.Specular;
+	entry.innerCutOff = light.InnerCutOff;
+	entry.direction = light.Direction;
+	entry.outerCutOff = light.OuterCutOff;
+	entry.constant = light.AttenuationConstant;
+	entry.linear = light.AttenuationLinear;
+	entry.quadratic = light.AttenuationQuadratic;
+	return entry;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#ifndef SCENE_UNIFORMS_H
+#define SCENE_UNIFORMS_H
+
+#include <utility>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "LightClusters.hpp"
+#include "LightSource.h"
+
+// std140 mirror of the Light struct of Shaders/common/lights.glsl: the scalars fill the 4th component
+// after each vec3, so an entry is 96 bytes instead of 112 in declaration order
+struct LightBlockEntry {
+	glm::vec4 position;
+	glm::vec3 ambient;
+	GLint spotlight;
+	glm::vec3 diffuse;
+	GLint attenuationBool;
+	glm::vec3 specular;
+	GLfloat innerCutOff;
+	glm::vec3 direction;
+	GLfloat outerCutOff;
+	GLfloat constant;
+	GLfloat linear;
+	GLfloat quadratic;
+	GLfloat padding;
+};
+static_assert(sizeof(LightBlockEntry) == 96, "LightBlockEntry must match the std140 layout of Light");
+
+// Uniform buffers shared by every program: FrameData (camera of the view being rendered) and LightData (light list).
+// FrameData is filled once per view instead of setting the same uniforms on each program for each draw. LightData holds one
+// light list per lit object: the lights are culled against the bounding sphere of the object (see LightCulling) and each list
+// is written to its own slot of the light buffer, bound with glBindBufferRange before the object is drawn.
+// With clustered lighting, LightData is left aside: every light goes to a texture buffer (lightTexels), the lights are
+// binned in the clusters of each view (see LightClusters) and ClusterData gives the shaders the layout of the clusters
+class SceneUniforms {
+public:
+	static const GLuint frameBinding = 0;
+	static const GLuint lightBinding = 1;
+	static const int maxLights = 10; // NR_POINT_LIGHTS in the shaders
+	static const int lightSlots = 128; // light lists per frame, slot 0 holds the unculled list
+	static const GLuint clusterBinding = 2;
+	static const GLuint lightTexelUnit = 16; // texture units of the texture buffers of the clusters, not used by the draws
+	static const GLuint clusterRangeUnit = 17;
+	static const GLuint clusterIndexUnit = 18;
+
+	// Creates the buffers and binds them; must be called before the programs are linked so that their blocks and samplers get
+	// their binding points. clustered selects the clustered lighting (the programs built with CLUSTERED_LIGHTING), if supported
+	void create(bool clustered);
+
+	// Switches between clustered lighting and the per object light lists from the next updateLights, the programs must be
+	// switched to the matching variants. Clustered lighting is refused when the driver lacks the texture units it uses
+	void setClustered(bool clustered);
+	bool clustered() const { return mClustered; }
+
+	// True if the driver has the texture units of the texture buffers of the clusters (OpenGL 3.3 only guarantees 16)
+	static bool clusteredSupported();
+
+	// Camera of the view about to be rendered, the clusters of the view are built from the lights of updateLights
+	void updateFrame(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos, float farPlane);
+
+	// Lights of the frame, shadowCaster is the light of the shadow cubemap (may be null). Slot 0 gets the first maxLights
+	// lights, unculled, and is bound until bindLightsFor is called
+	void updateLights(const std::vector<LightSource*>& lights, const LightSource* shadowCaster);
+
+	// Writes the lights reaching this bounding sphere (world space) to the next slot and binds it, to be called before drawing
+	// a lit object. Falls back on slot 0 once the slots of the frame are used up. Does nothing with clustered lighting
+	void bindLightsFor(const glm::vec3& center, float radius);
+
+private:
+	struct FrameBlock {
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 viewPos;
+		GLfloat farPlane;
+	};
+
+	struct LightBlock {
+		LightBlockEntry light[maxLights];
+		GLint lightCounter;
+		GLint sunLight; // index of the shadow caster in the list, -1 if it is not in it
+		GLint padding[2];
+	};
+
+	struct ClusterBlock {
+		glm::ivec4 grid; // tiles x, tiles y, depth slices, index of the shadow caster in lightTexels (-1 if none)
+		glm::vec4 depth; // near plane, far plane, slice scale, slice bias
+	};
+
+	static LightBlockEntry lightEntry(const LightSource& light);
+
+	// fills the block with these lights (indices in mLights) and writes it to the slot
+	void writeLightSlot(int slot, const std::vector<int>& selected);
+	void bindLightSlot(int slot);
+
+	// bins the lights for that camera and uploads the clusters
+	void updateClusters(const glm::mat4& view, const glm::mat4& projection);
+	static void createTextureBuffer(GLuint unit, GLenum format, GLuint& buffer, GLuint& texture);
+	static void uploadTextureBuffer(GLuint buffer, GLsizeiptr size, const void* data);
+
+	GLuint frameBuffer = 0;
+	GLuint lightBuffer = 0;
+	GLsizeiptr lightSlotSize = 0; // sizeof(LightBlock) rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+
+	std::vector<LightSource*> mLights; // lights of the frame
+	std::vector<float> mInfluenceRadii; // of mLights
+	const LightSource* mShadowCaster = nullptr;
+	int mNextLightSlot = 1;
+	std::vector<int> mSelected; // kept to avoid allocating for each object
+	std::vector<std::pair<float, int> > mCandidates; // scratch of LightCulling::select, same reason
+
+	bool mClustered = false;
+	bool mClusterResources = false; // buffers and textures of the clusters created
+	GLuint clusterBuffer = 0;
+	GLuint lightTexelBuffer = 0, lightTexelTexture = 0;
+	GLuint clusterRangeBuffer = 0, clusterRangeTexture = 0;
+	GLuint clusterIndexBuffer = 0, clusterIndexTexture = 0;
+	LightClusters mClusters;
+	std::vector<LightBlockEntry> mLightTexels;
+	GLint mSunIndex = -1;
+};
+
+#endif
@@ -1,6 +1,8 @@
 #include "Shader.hpp"
 
+#include <algorithm>
 #include <fstream>
+#include <set>
 #include <sstream>
 
 #include <iostream>
@@ -11,71 +13,347 @@ Shader::Shader(const GLchar *vertexPath, const GLchar *fragmentPath, const GLcha
 	mGeometryPath = geometryPath;
 	mTessCPath = tessCPath;
 	mTessEPath = tessEPath;
+	mProgram = std::make_shared<Program>();
+	mVariants = std::make_shared<std::map<std::string, Shader> >();
 }
 
 Shader::Shader() {//default constructor for global variable
+	mProgram = std::make_shared<Program>();
+	mVariants = std::make_shared<std::map<std::string, Shader> >();
 }
 
 Shader &Shader::use() {
-	glUseProgram(ID);
+	glUseProgram(mProgram->id);
 	return *this;
 }
 
 void Shader::compile() {
+	bool linked = false;
+	mProgram->id = buildProgram(mProgram->files, linked);
+	reflectUniforms();
+	bindUniformBlocks();
+	bindSamplers();
+	compiledShaders().push_back(*this);
+}
+
+bool Shader::reload() {
+	std::vector<std::string> files;
+	bool linked = false;
+	GLuint program = buildProgram(files, linked);
+	if (!linked) {
+		glDeleteProgram(program);
+		std::cout << "| ERROR::SHADER: " << mProgram->files.front() << " failed to rebuild, the previous program stays in use" << std::endl;
+		return false;
+	}
+
+	copyUniforms(mProgram->id, program);
+	glDeleteProgram(mProgram->id);
+	mProgram->id = program;
+	mProgram->files = files;
+	reflectUniforms();
+	bindUniformBlocks();
+	bindSamplers();
+	return true;
+}
+
+std::vector<Shader> &Shader::compiledShaders() {
+	static std::vector<Shader> shaders;
+	return shaders;
+}
+
+int Shader::reloadChangedFiles(const std::set<std::string> &files) {
+	for (std::set<std::string>::const_iterator it = files.begin(); it != files.end(); ++it)
+		fileCache().erase(*it);
+
+	int reloaded = 0;
+	std::vector<Shader> &shaders = compiledShaders();
+	for (unsigned int i = 0; i < shaders.size(); i++) {
+		const std::vector<std::string> &sources = shaders[i].sourceFiles();
+		bool changed = false;
+		for (unsigned int j = 0; j < sources.size() && !changed; j++)
+			changed = files.count(sources[j]) != 0;
+		if (changed && shaders[i].reload())
+			reloaded++;
+	}
+	return reloaded;
+}
 
-	GLuint vertexShader = pathToShader(mVertexPath, GL_VERTEX_SHADER);
-	GLuint fragmentShader = pathToShader(mFragmentPath, GL_FRAGMENT_SHADER);
-	GLuint geometryShader = (mGeometryPath)? pathToShader(mGeometryPath, GL_GEOMETRY_SHADER) : 0;
-	GLuint tessCShader = (mTessCPath) ? pathToShader(mTessCPath, GL_TESS_CONTROL_SHADER) : 0;
-	GLuint tessEShader = (mTessEPath) ? pathToShader(mTessEPath, GL_TESS_EVALUATION_SHADER) : 0;
+GLuint Shader::buildProgram(std::vector<std::string> &files, bool &linked) {
+	std::vector<ShaderStageSource> stages;
+	addStage(stages, mVertexPath, GL_VERTEX_SHADER);
+	addStage(stages, mFragmentPath, GL_FRAGMENT_SHADER);
+	addStage(stages, mGeometryPath, GL_GEOMETRY_SHADER);
+	addStage(stages, mTessCPath, GL_TESS_CONTROL_SHADER);
+	addStage(stages, mTessEPath, GL_TESS_EVALUATION_SHADER);
+	files.clear();
+	for (unsigned int i = 0; i < stages.size(); i++)
+		for (unsigned int j = 0; j < stages[i].files.size(); j++)
+			if (std::find(files.begin(), files.end(), stages[i].files[j]) == files.end())
+				files.push_back(stages[i].files[j]);
 
 	// Create Program
-	ID = glCreateProgram();
-	
+	GLuint program = glCreateProgram();
+
+	// A program linked by a previous launch is loaded as is from the cache, skipping compilation and linking
+	const bool binaryCache = ProgramCache::isSupported();
+	const GLenum feedbackMode = GL_INTERLEAVED_ATTRIBS;
+	const uint64_t cacheKey = binaryCache ? ProgramCache::key(stages, mFeedbackVaryings, feedbackMode) : 0;
+	if (binaryCache && ProgramCache::load(program, cacheKey)) {
+		linked = true;
+		return program;
+	}
+
 	// Attach the shaders to the program
-	glAttachShader(ID, vertexShader);
-	glAttachShader(ID, fragmentShader);
-	if (mGeometryPath) glAttachShader(ID, geometryShader);
-	if (mTessCPath) glAttachShader(ID, tessCShader);
-	if (mTessEPath) glAttachShader(ID, tessEShader);
+	std::vector<GLuint> shaders;
+	for (unsigned int i = 0; i < stages.size(); i++) {
+		shaders.push_back(sourceToShader(stages[i]));
+		glAttachShader(program, shaders.back());
+	}
 
-	glLinkProgram(ID);
-	checkCompileErrors(ID, "Program");
+	if (!mFeedbackVaryings.empty()) {
+		std::vector<const GLchar*> varyings;
+		for (unsigned int i = 0; i < mFeedbackVaryings.size(); i++)
+			varyings.push_back(mFeedbackVaryings[i].c_str());
+		glTransformFeedbackVaryings(program, (GLsizei)varyings.size(), &varyings[0], feedbackMode);
+	}
+	if (binaryCache)
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	glLinkProgram(program);
+	checkCompileErrors(program, "Program");
 
 	// Delete the shaders as they're linked into our program now and no longer necessery
-	glDeleteShader(vertexShader);
-	glDeleteShader(fragmentShader);
-	if (mGeometryPath) glDeleteShader(geometryShader);
-	if (mTessCPath) glDeleteShader(tessCShader);
-	if (mTessEPath) glDeleteShader(tessEShader);
+	for (unsigned int i = 0; i < shaders.size(); i++) {
+		glDetachShader(program, shaders[i]);
+		glDeleteShader(shaders[i]);
+	}
+
+	GLint linkStatus = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+	linked = linkStatus == GL_TRUE;
+	if (binaryCache && linked && !ProgramCache::store(program, cacheKey))
+		std::cout << "| ERROR::SHADER: could not write the program cache of " << mVertexPath << std::endl;
+	return program;
+}
+
+void Shader::copyUniforms(GLuint from, GLuint to) {
+	GLint previous = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+	glUseProgram(to);
+
+	GLint uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(to, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(to, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::string name(maxNameLength > 0 ? maxNameLength : 1, '\0');
+	for (GLint i = 0; i < uniformCount; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type;
+		glGetActiveUniform(to, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+		std::string uniformName(name.data(), length);
+		size_t bracket = uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0 ? uniformName.size() - 3 : std::string::npos;
+		for (GLint element = 0; element < size; element++) {
+			std::string elementName = bracket == std::string::npos ? uniformName : uniformName.substr(0, bracket) + "[" + std::to_string(element) + "]";
+			GLint source = glGetUniformLocation(from, elementName.c_str());
+			GLint target = glGetUniformLocation(to, elementName.c_str());
+			if (source < 0 || target < 0) //new uniform, or uniform of a block
+				continue;
+
+			GLfloat floats[16];
+			GLint ints[4];
+			switch (type) {
+			case GL_FLOAT: glGetUniformfv(from, source, floats); glUniform1fv(target, 1, floats); break;
+			case GL_FLOAT_VEC2: glGetUniformfv(from, source, floats); glUniform2fv(target, 1, floats); break;
+			case GL_FLOAT_VEC3: glGetUniformfv(from, source, floats); glUniform3fv(target, 1, floats); break;
+			case GL_FLOAT_VEC4: glGetUniformfv(from, source, floats); glUniform4fv(target, 1, floats); break;
+			case GL_FLOAT_MAT2: glGetUniformfv(from, source, floats); glUniformMatrix2fv(target, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT3: glGetUniformfv(from, source, floats); glUniformMatrix3fv(target, 1, GL_FALSE, floats); break;
+			case GL_FLOAT_MAT4: glGetUniformfv(from, source, floats); glUniformMatrix4fv(target, 1, GL_FALSE, floats); break;
+			case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, source, ints); glUniform2iv(target, 1, ints); break;
+			case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, source, ints); glUniform3iv(target, 1, ints); break;
+			case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, source, ints); glUniform4iv(target, 1, ints); break;
+			default: //int, bool and the samplers
+				glGetUniformiv(from, source, ints);
+				glUniform1iv(target, 1, ints);
+				break;
+			}
+		}
+	}
+	glUseProgram(previous);
+}
+
+Shader &Shader::variant(const std::vector<std::string> &defines) {
+	if (defines.empty()) {
+		if (mProgram->id == 0)
+			compile();
+		return *this;
+	}
+
+	std::vector<std::string> sorted = defines;
+	std::sort(sorted.begin(), sorted.end());
+	std::string key;
+	for (unsigned int i = 0; i < sorted.size(); i++)
+		key += sorted[i] + '\n';
+
+	std::map<std::string, Shader>::iterator found = mVariants->find(key);
+	if (found != mVariants->end())
+		return found->second;
+
+	Shader specialized(mVertexPath, mFragmentPath, mGeometryPath, mTessCPath, mTessEPath);
+	specialized.mDefines = sorted;
+	specialized.mFeedbackVaryings = mFeedbackVaryings;
+	Shader &inserted = mVariants->insert(std::make_pair(key, specialized)).first->second;
+	inserted.compile();
+	return inserted;
+}
+
+void Shader::setFeedbackVaryings(const std::vector<std::string> &varyings) {
+	mFeedbackVaryings = varyings;
+}
+
+std::string Shader::injectDefines(const std::string &code) const {
+	if (mDefines.empty())
+		return code;
+
+	std::string defines;
+	for (unsigned int i = 0; i < mDefines.size(); i++)
+		defines += "#define " + mDefines[i] + '\n';
+
+	// #version must stay the first statement, the defines go right after it
+	size_t version = code.find("#version");
+	if (version == std::string::npos)
+		return defines + "#line 1\n" + code;
+	size_t lineEnd = code.find('\n', version);
+	if (lineEnd == std::string::npos)
+		return code + '\n' + defines;
+	int nextLine = 2 + (int)std::count(code.begin(), code.begin() + version, '\n');
+	return code.substr(0, lineEnd + 1) + defines + "#line " + std::to_string(nextLine) + '\n' + code.substr(lineEnd + 1);
+}
+
+void Shader::addStage(std::vector<ShaderStageSource> &stages, const GLchar *path, GLenum shaderType) {
+	if (!path)
+		return;
+	ShaderStageSource stage;
+	stage.type = shaderType;
+	stage.files.push_back(path);
+	std::set<std::string> included;
+	included.insert(path);
+	stage.code = injectDefines(expandIncludes(path, 0, included, stage.files));
+	stages.push_back(stage);
 }
 
 void Shader::setFloat(const GLchar *name, GLfloat value) {
-	glUniform1f(glGetUniformLocation(ID, name), value);
+	glUniform1f(uniformLocation(name), value);
 }
 void Shader::setInteger(const GLchar *name, GLint value) {
-	glUniform1i(glGetUniformLocation(ID, name), value);
+	glUniform1i(uniformLocation(name), value);
 }
 void Shader::setVector2f(const GLchar *name, GLfloat x, GLfloat y) {
-	glUniform2f(glGetUniformLocation(ID, name), x, y);
+	glUniform2f(uniformLocation(name), x, y);
 }
 void Shader::setVector2f(const GLchar *name, const glm::vec2 &value) {
-	glUniform2f(glGetUniformLocation(ID, name), value.x, value.y);
+	glUniform2f(uniformLocation(name), value.x, value.y);
 }
 void Shader::setVector3f(const GLchar *name, GLfloat x, GLfloat y, GLfloat z) {
-	glUniform3f(glGetUniformLocation(ID, name), x, y, z);
+	glUniform3f(uniformLocation(name), x, y, z);
 }
 void Shader::setVector3f(const GLchar *name, const glm::vec3 &value) {
-	glUniform3f(glGetUniformLocation(ID, name), value.x, value.y, value.z);
+	glUniform3f(uniformLocation(name), value.x, value.y, value.z);
 }
 void Shader::setVector4f(const GLchar *name, GLfloat x, GLfloat y, GLfloat z, GLfloat w) {
-	glUniform4f(glGetUniformLocation(ID, name), x, y, z, w);
+	glUniform4f(uniformLocation(name), x, y, z, w);
 }
 void Shader::setVector4f(const GLchar *name, const glm::vec4 &value) {
-	glUniform4f(glGetUniformLocation(ID, name), value.x, value.y, value.z, value.w);
+	glUniform4f(uniformLocation(name), value.x, value.y, value.z, value.w);
 }
 void Shader::setMatrix4(const GLchar *name, const glm::mat4 &matrix) {
-	glUniformMatrix4fv(glGetUniformLocation(ID, name), 1, GL_FALSE, glm::value_ptr(matrix));
+	glUniformMatrix4fv(uniformLocation(name), 1, GL_FALSE, glm::value_ptr(matrix));
+}
+
+void Shader::setMatrix4Array(const GLchar *name, GLsizei count, const glm::mat4 *matrices) {
+	glUniformMatrix4fv(uniformLocation(name), count, GL_FALSE, glm::value_ptr(matrices[0]));
+}
+
+void Shader::setUniformBlockBinding(const std::string &blockName, GLuint binding) {
+	uniformBlockBindings()[blockName] = binding;
+}
+
+std::unordered_map<std::string, GLuint> &Shader::uniformBlockBindings() {
+	static std::unordered_map<std::string, GLuint> bindings;
+	return bindings;
+}
+
+void Shader::bindUniformBlocks() {
+	const std::unordered_map<std::string, GLuint> &bindings = uniformBlockBindings();
+	for (std::unordered_map<std::string, GLuint>::const_iterator it = bindings.begin(); it != bindings.end(); ++it) {
+		GLuint blockIndex = glGetUniformBlockIndex(mProgram->id, it->first.c_str());
+		if (blockIndex != GL_INVALID_INDEX)
+			glUniformBlockBinding(mProgram->id, blockIndex, it->second);
+	}
+}
+
+void Shader::setSamplerBinding(const std::string &samplerName, GLint unit) {
+	samplerBindings()[samplerName] = unit;
+}
+
+std::unordered_map<std::string, GLint> &Shader::samplerBindings() {
+	static std::unordered_map<std::string, GLint> bindings;
+	return bindings;
+}
+
+void Shader::bindSamplers() {
+	GLint current = 0;
+	glGetIntegerv(GL_CURRENT_PROGRAM, &current);
+	glUseProgram(mProgram->id);
+	const std::unordered_map<std::string, GLint> &bindings = samplerBindings();
+	for (std::unordered_map<std::string, GLint>::const_iterator it = bindings.begin(); it != bindings.end(); ++it)
+		glUniform1i(uniformLocation(it->first.c_str()), it->second);
+	glUseProgram(current);
+}
+
+GLint Shader::uniformLocation(const GLchar *name) const {
+	std::unordered_map<uint64_t, GLint>::const_iterator found = mProgram->uniformLocations.find(hashName(name));
+	return found != mProgram->uniformLocations.end() ? found->second : -1;
+}
+
+uint64_t Shader::hashName(const GLchar *name) {
+	uint64_t hash = 14695981039346656037ull;
+	for (; *name; name++) {
+		hash ^= (unsigned char)*name;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+void Shader::reflectUniforms() {
+	std::unordered_map<uint64_t, GLint> &locations = mProgram->uniformLocations;
+	locations.clear();
+	const GLuint program = mProgram->id;
+	GLint uniformCount = 0, maxNameLength = 0;
+	glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+	glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::string name(maxNameLength > 0 ? maxNameLength : 1, '\0');
+	for (GLint i = 0; i < uniformCount; i++) {
+		GLsizei length = 0;
+		GLint size = 0;
+		GLenum type;
+		glGetActiveUniform(program, (GLuint)i, (GLsizei)name.size(), &length, &size, &type, &name[0]);
+		std::string uniformName(name.data(), length);
+		GLint location = glGetUniformLocation(program, uniformName.c_str());
+		if (location < 0) //uniforms of blocks have no location
+			continue;
+		//arrays of basic types are listed once as "name[0]": "name" and every "name[i]" are valid names for their elements
+		size_t bracket = uniformName.size() > 3 && uniformName.compare(uniformName.size() - 3, 3, "[0]") == 0 ? uniformName.size() - 3 : std::string::npos;
+		if (bracket != std::string::npos) {
+			std::string baseName = uniformName.substr(0, bracket);
+			locations[hashName(baseName.c_str())] = location;
+			for (GLint element = 0; element < size; element++) {
+				std::string elementName = baseName + "[" + std::to_string(element) + "]";
+				locations[hashName(elementName.c_str())] = glGetUniformLocation(program, elementName.c_str());
+			}
+		}
+		else
+			locations[hashName(uniformName.c_str())] = location;
+	}
 }
 
 void Shader::checkCompileErrors(const GLuint &object, std::string type) {
@@ -99,23 +377,94 @@ void Shader::checkCompileErrors(const GLuint &object, std::string type) {
 	}
 }
 
-GLuint Shader::pathToShader(const GLchar* path, GLenum shaderType) {
+std::unordered_map<std::string, std::string> &Shader::fileCache() {
+	static std::unordered_map<std::string, std::string> files;
+	return files;
+}
+
+const std::string &Shader::readShaderFile(const std::string &path) {
+	std::unordered_map<std::string, std::string>::const_iterator cached = fileCache().find(path);
+	if (cached != fileCache().end())
+		return cached->second;
+
 	std::ifstream shaderFile;
 	std::stringstream shaderStream;
 
-	shaderFile.open(path);
+	shaderFile.open(path.c_str());
+	if (!shaderFile.is_open()) {
+		std::cout << "| ERROR::SHADER: could not open " << path << std::endl;
+		static const std::string missing;
+		return missing; //not cached, the file may appear later
+	}
 	shaderStream << shaderFile.rdbuf();
 	shaderFile.close();
+	return fileCache()[path] = shaderStream.str();
+}
+
+std::string Shader::expandIncludes(const std::string &path, int sourceString, std::set<std::string> &included, std::vector<std::string> &files) {
+	const std::string &code = readShaderFile(path);
+	const size_t slash = path.find_last_of("/\\");
+	const std::string directory = slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+
+	std::string expanded;
+	expanded.reserve(code.size());
+	int lineNumber = 0;
+	size_t lineStart = 0;
+	while (lineStart < code.size()) {
+		size_t lineEnd = code.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = code.size();
+		lineNumber++;
 
-	std::string code = shaderStream.str();
-	const GLchar * ccode = code.c_str();
+		size_t directive = code.find_first_not_of(" \t", lineStart);
+		if (directive == std::string::npos || directive >= lineEnd || code.compare(directive, 8, "#include") != 0) {
+			expanded.append(code, lineStart, lineEnd - lineStart);
+			expanded += '\n';
+			lineStart = lineEnd + 1;
+			continue;
+		}
+
+		size_t open = code.find('"', directive + 8);
+		size_t close = open < lineEnd ? code.find('"', open + 1) : std::string::npos;
+		if (close == std::string::npos || close >= lineEnd) {
+			std::cout << "| ERROR::SHADER: malformed #include in " << path << " line " << lineNumber << std::endl;
+			expanded += '\n';
+			lineStart = lineEnd + 1;
+			continue;
+		}
+
+		const std::string includePath = directory + code.substr(open + 1, close - open - 1);
+		if (included.insert(includePath).second) { //a file already included in this stage is skipped (include guard)
+			const int includeString = (int)files.size();
+			files.push_back(includePath);
+			expanded += "#line 1 " + std::to_string(includeString) + '\n';
+			expanded += expandIncludes(includePath, includeString, included, files);
+			expanded += "#line " + std::to_string(lineNumber + 1) + ' ' + std::to_string(sourceString) + '\n';
+		}
+		else
+			expanded += '\n';
+		lineStart = lineEnd + 1;
+	}
+	return expanded;
+}
+
+GLuint Shader::sourceToShader(const ShaderStageSource &stage) {
+	const GLchar * ccode = stage.code.c_str();
 
 	// Vertex Shader
 	GLuint shader;
-	shader = glCreateShader(shaderType);
+	shader = glCreateShader(stage.type);
 	glShaderSource(shader, 1, &ccode, NULL);
 	glCompileShader(shader);
-	checkCompileErrors(shader, shaderTypeToString(shaderType));
+	checkCompileErrors(shader, shaderTypeToString(stage.type));
+
+	// the logs give lines as "source string(line)", each included file has its own source string
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled != GL_TRUE && stage.files.size() > 1) {
+		for (unsigned int i = 0; i < stage.files.size(); i++)
+			std::cout << "|   source string " << i << ": " << stage.files[i] << std::endl;
+	}
 
 	return shader;
 }
@@ -3,18 +3,28 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
-// Simple shader class from http://www.learnopengl.com/ with a few tweaks
+#include "ProgramCache.hpp"
+
+// Simple shader class from http://www.learnopengl.com/ with a few tweaks.
+// The locations of the active uniforms are read once when the program is linked: the setters look them up in a hash table
+// instead of asking the driver for every call. The program and its table are shared by all the copies of the Shader, so that
+// a program recompiled by reload() is used by every copy at once.
+// A Shader can also give specialized variants of its program, compiled with a set of #defines inserted after #version.
+// Sources can #include "file" (relative to the including file) to share code, e.g. the files of Shaders/common
 class Shader {
 public:
-	// State
-	GLuint ID;
-
 	// Constructor
 	Shader(const GLchar *vertexSource, const GLchar *fragmentSource, const GLchar *geometrySource = nullptr, const GLchar *tessCPath = nullptr, const GLchar *tessEPath = nullptr);
 	Shader();
@@ -25,6 +35,14 @@ public:
 	// Not sure compile should be it's own step separate from constructor
 	void compile();
 
+	// Program compiled from the same files with these #defines ("NAME" or "NAME value"), compiled on the first request
+	// and kept for the next ones. The order of the defines does not matter; no define gives this Shader itself (compiled if it was not)
+	Shader& variant(const std::vector<std::string> &defines);
+
+	// Outputs of the last vertex processing stage captured by transform feedback (interleaved in one buffer, in this order),
+	// given to the program before it is linked: set before compile() or variant(), the variants capture the same outputs
+	void setFeedbackVaryings(const std::vector<std::string> &varyings);
+
 	void setFloat(const GLchar *name, GLfloat value);
 	void setInteger(const GLchar *name, GLint value);
 
@@ -38,12 +56,85 @@ public:
 	void setVector4f(const GLchar *name, const glm::vec4 &value);
 
 	void setMatrix4(const GLchar *name, const glm::mat4 &matrix);
+	// Sets count elements of a mat4 array in one call, starting with the element named name ("array" or "array[i]")
+	void setMatrix4Array(const GLchar *name, GLsizei count, const glm::mat4 *matrices);
+
+	// Binding point given to the uniform block of that name in every program linked afterwards (blocks shared by all the programs)
+	static void setUniformBlockBinding(const std::string &blockName, GLuint binding);
+
+	// Texture unit given to the sampler of that name in every program linked afterwards (textures bound once for all the programs)
+	static void setSamplerBinding(const std::string &samplerName, GLint unit);
+
+	// Compiles the program again from its files and swaps it in if it links, keeping the values of its uniforms.
+	// On failure the errors are printed and the previous program stays in use (GL thread only)
+	bool reload();
+
+	// Files read to build the program: its stages and every file they include
+	const std::vector<std::string> &sourceFiles() const { return mProgram->files; }
+
+	// Every compiled program (a copy of its Shader), in compilation order
+	static std::vector<Shader> &compiledShaders();
+
+	// Reloads the compiled programs built from one of these files, the cached contents of the files are read again.
+	// Returns the number of programs reloaded (GL thread only)
+	static int reloadChangedFiles(const std::set<std::string> &files);
+
+	// Location of an active uniform, -1 if the program has no such uniform (the setters then do nothing, as with glGetUniformLocation)
+	GLint uniformLocation(const GLchar *name) const;
 private:
+	// State of a program shared by the copies of a Shader
+	struct Program {
+		GLuint id = 0;
+		std::unordered_map<uint64_t, GLint> uniformLocations; // by name hash
+		std::vector<std::string> files;
+	};
+
+	// Compiles and links a new program from the files (or loads it from the program binary cache), linked tells if it succeeded
+	GLuint buildProgram(std::vector<std::string> &files, bool &linked);
+
+	// Gives the uniforms of the program to the same uniforms of another program, those that are active in both
+	static void copyUniforms(GLuint from, GLuint to);
+
+	// Fills the location table with every active uniform of the linked program (each element of the arrays has its own entry)
+	void reflectUniforms();
+
+	// Binds the registered uniform blocks the program uses to their binding points
+	void bindUniformBlocks();
+
+	// Uniform block bindings registered by setUniformBlockBinding
+	static std::unordered_map<std::string, GLuint> &uniformBlockBindings();
+
+	// Sets the registered samplers the program uses to their texture units
+	void bindSamplers();
+
+	// Sampler units registered by setSamplerBinding
+	static std::unordered_map<std::string, GLint> &samplerBindings();
+
+	// FNV-1a hash of a uniform name, computed on the C string so that looking a name up allocates nothing
+	static uint64_t hashName(const GLchar *name);
+
 	// Checks if compilation or linking failed and if so, print the error logs
 	void checkCompileErrors(const GLuint &object, std::string type);
 
-	// Make a shader from a filepath
-	GLuint pathToShader(const GLchar * path, GLenum shaderType);
+	// Inserts the #defines of this variant after the #version line of a stage, #line keeps the error logs on the file's lines
+	std::string injectDefines(const std::string &code) const;
+
+	// Reads the source of a stage (if it has a path) and adds it to the program
+	void addStage(std::vector<ShaderStageSource> &stages, const GLchar *path, GLenum shaderType);
+
+	// Contents of the shader files already read, by path: a file included by many programs is read from the disk once
+	static std::unordered_map<std::string, std::string> &fileCache();
+
+	// Reads a shader file (through the file cache)
+	static const std::string &readShaderFile(const std::string &path);
+
+	// Source of a file with its #include "file" directives replaced by the included files, recursively. A file already in
+	// included is skipped, so each file appears once per stage like with an include guard. #line directives give each file
+	// its own source string number (its index in files) so that the error logs point at the right file and line
+	static std::string expandIncludes(const std::string &path, int sourceString, std::set<std::string> &included, std::vector<std::string> &files);
+
+	// Make a shader from the source code of a stage
+	GLuint sourceToShader(const ShaderStageSource &stage);
 
 	// Get a string of the shader type from the GLenum
 	std::string shaderTypeToString(GLenum shaderType);
@@ -53,6 +144,18 @@ private:
 	const GLchar* mGeometryPath;
 	const GLchar* mTessCPath;
 	const GLchar* mTessEPath;
+
+	// Shared so that copies made before compile() (e.g. by value) see the program as well, and that reload() reaches every copy
+	std::shared_ptr<Program> mProgram;
+
+	// #defines this program is compiled with (empty for the base program)
+	std::vector<std::string> mDefines;
+
+	// Outputs captured by transform feedback (empty: none)
+	std::vector<std::string> mFeedbackVaryings;
+
+	// Variants built by variant(), keyed by their sorted defines; shared by the copies like the uniform table
+	std::shared_ptr<std::map<std::string, Shader> > mVariants;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#include "ShaderReloader.hpp"
+
+#include <chrono>
+#include <iostream>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "Shader.hpp"
+
+ShaderReloader::ShaderReloader(unsigned int pollIntervalMs)
+	: mPollIntervalMs(pollIntervalMs), mWatchedShaders(0), mStop(false), mHasChanges(false) {
+	mThread = std::thread(&ShaderReloader::watch, this);
+}
+
+ShaderReloader::~ShaderReloader() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mCondition.notify_one();
+	mThread.join();
+}
+
+int ShaderReloader::update() {
+	std::vector<Shader>& shaders = Shader::compiledShaders();
+	if (mWatchedShaders < shaders.size()) {
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (; mWatchedShaders < shaders.size(); mWatchedShaders++) {
+			const std::vector<std::string>& files = shaders[mWatchedShaders].sourceFiles();
+			mNewFiles.insert(mNewFiles.end(), files.begin(), files.end());
+		}
+	}
+
+	if (!mHasChanges.load())
+		return 0;
+	std::set<std::string> changed;
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		changed.swap(mChangedFiles);
+		mHasChanges = false;
+	}
+	for (std::set<std::string>::const_iterator it = changed.begin(); it != changed.end(); ++it)
+		std::cout << "SHADERRELOADER:: " << *it << " changed" << std::endl;
+	int reloaded = Shader::reloadChangedFiles(changed);
+	//the new versions may include other files, the watcher ignores the ones it already knows
+	std::lock_guard<std::mutex> lock(mMutex);
+	for (unsigned int i = 0; i < shaders.size(); i++) {
+		const std::vector<std::string>& files = shaders[i].sourceFiles();
+		mNewFiles.insert(mNewFiles.end(), files.begin(), files.end());
+	}
+	return reloaded;
+}
+
+ShaderReloader::FileStamp ShaderReloader::stamp(const std::string& path) {
+	FileStamp result;
+	struct stat info;
+	if (stat(path.c_str(), &info) == 0) {
+		result.modified = info.st_mtime;
+		result.size = (long long)info.st_size;
+	}
+	return result;
+}
+
+void ShaderReloader::watch() {
+	std::unique_lock<std::mutex> lock(mMutex);
+	while (!mStop) {
+		std::vector<std::string> newFiles;
+		newFiles.swap(mNewFiles);
+		lock.unlock();
+
+		for (unsigned int i = 0; i < newFiles.size(); i++)
+			if (mStamps.find(newFiles[i]) == mStamps.end())
+				mStamps[newFiles[i]] = stamp(newFiles[i]);
+
+		std::vector<std::string> changed;
+		for (std::unordered_map<std::string, FileStamp>::iterator it = mStamps.begin(); it != mStamps.end(); ++it) {
+			FileStamp current = stamp(it->first);
+			if (current.size < 0) //being replaced, checked again at the next poll
+				continue;
+			if (current.modified != it->second.modified || current.size != it->second.size) {
+				it->second = current;
+				changed.push_back(it->first);
+			}
+		}
+
+		lock.lock();
+		if (!changed.empty()) {
+			mChangedFiles.insert(changed.begin(), changed.end());
+			mHasChanges = true;
+		}
+		mCondition.wait_for(lock, std::chrono::milliseconds(mPollIntervalMs), [this]() { return mStop; });
+	}
+}
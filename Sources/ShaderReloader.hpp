@@ -0,0 +1,52 @@
+#pragma once
+
+#ifndef SHADER_RELOADER_H
+#define SHADER_RELOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Hot reload of the shaders: a watcher thread polls the modification time of the source files of every compiled program
+// (includes too) and update(), called once per frame, recompiles the programs whose files changed and swaps them in
+// between two frames. A program that fails to compile is reported and the previous one stays in use
+class ShaderReloader {
+public:
+	explicit ShaderReloader(unsigned int pollIntervalMs = 250);
+	// stops and joins the watcher thread
+	~ShaderReloader();
+
+	// watches the files of the programs compiled since the last call, then reloads the programs of the files that changed (GL thread only).
+	// Returns the number of programs swapped
+	int update();
+
+	ShaderReloader(const ShaderReloader&) = delete;
+	ShaderReloader& operator=(const ShaderReloader&) = delete;
+private:
+	struct FileStamp {
+		time_t modified = 0;
+		long long size = -1; //-1 while the file cannot be read (e.g. replaced by the editor)
+	};
+
+	static FileStamp stamp(const std::string& path);
+	void watch();
+
+	unsigned int mPollIntervalMs;
+	size_t mWatchedShaders; //programs of Shader::compiledShaders() whose files were given to the watcher
+	std::thread mThread;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStop;
+	std::vector<std::string> mNewFiles; //files to start watching, under mMutex
+	std::set<std::string> mChangedFiles; //files modified since the last update, under mMutex
+	std::atomic<bool> mHasChanges; //lets update() skip the lock on the frames without changes
+	std::unordered_map<std::string, FileStamp> mStamps; //watcher thread only
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include "ShadowCache.hpp"
+
+void ShadowCache::create(GLuint shadowCubemap, GLsizei size) {
+	mShadowCubemap = shadowCubemap;
+	mSize = size;
+
+	//same format as the shadow cubemap, so that the depth is copied by blits
+	glGenTextures(1, &mStaticCubemap);
+	allocate(mStaticCubemap, size);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, mStaticCubemap);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+	glGenFramebuffers(1, &mDrawFBO);
+	glGenFramebuffers(1, &mReadFBO);
+	GLuint fbos[2] = { mDrawFBO, mReadFBO };
+	for (GLuint fbo : fbos) {
+		glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+		glDrawBuffer(GL_NONE); //depth only
+		glReadBuffer(GL_NONE);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void ShadowCache::resize(GLsizei size) {
+	if (size == mSize)
+		return;
+	mSize = size;
+	allocate(mShadowCubemap, size);
+	allocate(mStaticCubemap, size);
+	invalidate();
+}
+
+void ShadowCache::setLight(const glm::vec3& lightPos, const glm::mat4* faceMatrices) {
+	//planes of each clip space frustum (Gribb-Hartmann): row 3 +- row 0, 1 and 2 of the matrix
+	for (unsigned int face = 0; face < 6; face++) {
+		const glm::mat4& m = faceMatrices[face];
+		const glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		const glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		const glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		const glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+		const glm::vec4 planes[6] = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+		for (unsigned int i = 0; i < 6; i++)
+			mFacePlanes[face][i] = planes[i] / glm::length(glm::vec3(planes[i]));
+	}
+
+	if (lightPos != mLightPos) {
+		mLightPos = lightPos;
+		invalidate();
+	}
+}
+
+void ShadowCache::invalidate() {
+	mStaticDirty = allFaces;
+	mPreviousDynamic = allFaces;
+}
+
+void ShadowCache::clear() {
+	glDepthMask(GL_TRUE);
+	for (unsigned int face = 0; face < 6; face++) {
+		attachFace(mShadowCubemap, face);
+		glClear(GL_DEPTH_BUFFER_BIT);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	invalidate();
+}
+
+void ShadowCache::trackStatic(int caster, const glm::vec3& center, float radius, uint64_t key) {
+	const unsigned int faces = facesOf(center, radius);
+	std::map<int, StaticCaster>::iterator found = mStaticCasters.find(caster);
+	if (found == mStaticCasters.end()) {
+		mStaticCasters[caster] = { key, faces };
+		mStaticDirty |= faces;
+	}
+	else if (found->second.key != key) {
+		mStaticDirty |= found->second.faces | faces;
+		found->second.key = key;
+		found->second.faces = faces;
+	}
+}
+
+unsigned int ShadowCache::beginStatic() {
+	mStaticRendered = mStaticDirty;
+	mStaticDirty = 0;
+	glDepthMask(GL_TRUE);
+	for (unsigned int face = 0; face < 6; face++) {
+		if (mStaticRendered & (1u << face)) {
+			attachFace(mStaticCubemap, face);
+			glClear(GL_DEPTH_BUFFER_BIT);
+		}
+	}
+	return mStaticRendered;
+}
+
+void ShadowCache::bindStaticFace(unsigned int face) {
+	attachFace(mStaticCubemap, face);
+}
+
+unsigned int ShadowCache::beginDynamic(unsigned int dynamicFaces) {
+	mDynamic = dynamicFaces;
+	const unsigned int faces = mStaticRendered | mPreviousDynamic | mDynamic;
+	glDepthMask(GL_TRUE);
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, mReadFBO);
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mDrawFBO);
+	for (unsigned int face = 0; face < 6; face++) {
+		if (faces & (1u << face)) {
+			glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mStaticCubemap, 0);
+			glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mShadowCubemap, 0);
+			glBlitFramebuffer(0, 0, mSize, mSize, 0, 0, mSize, mSize, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		}
+	}
+	return faces;
+}
+
+void ShadowCache::bindFace(unsigned int face) {
+	attachFace(mShadowCubemap, face);
+}
+
+void ShadowCache::endFrame() {
+	mPreviousDynamic = mDynamic;
+	mStaticRendered = 0;
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+unsigned int ShadowCache::facesOf(const glm::vec3& center, float radius) const {
+	unsigned int faces = 0;
+	for (unsigned int face = 0; face < 6; face++) {
+		bool inside = true;
+		for (unsigned int i = 0; i < 6 && inside; i++)
+			inside = glm::dot(glm::vec3(mFacePlanes[face][i]), center) + mFacePlanes[face][i].w >= -radius;
+		if (inside)
+			faces |= 1u << face;
+	}
+	return faces;
+}
+
+void ShadowCache::allocate(GLuint cubemap, GLsizei size) {
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+	for (unsigned int i = 0; i < 6; ++i)
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
+
+void ShadowCache::attachFace(GLuint cubemap, unsigned int face) {
+	glBindFramebuffer(GL_FRAMEBUFFER, mDrawFBO);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cubemap, 0);
+}
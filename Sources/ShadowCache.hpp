@@ -0,0 +1,83 @@
+#pragma once
+
+#ifndef SHADOW_CACHE_H
+#define SHADOW_CACHE_H
+
+#include <cstdint>
+#include <map>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Depth cubemap of a point light, rendered face by face and split in two layers: the static casters are rendered in a cached
+// cubemap, only on the faces where one of them changed, and each frame the faces reached by a dynamic caster (this frame or
+// the previous one) get a copy of the cached depth before the dynamic casters are drawn on top. The faces nothing moved in
+// keep their depth from the previous frame. The casters are culled against the frustum of each face (facesOf), so that a
+// face only gets the draws of the casters it sees. Bit i of a face mask is the face GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+class ShadowCache {
+public:
+	static const unsigned int allFaces = 0x3F;
+
+	// shadowCubemap is the depth cubemap sampled by the lit shaders
+	void create(GLuint shadowCubemap, GLsizei size);
+
+	// New size of the faces of both cubemaps, everything is rendered again on the next frame
+	void resize(GLsizei size);
+	GLsizei size() const { return mSize; }
+
+	// Light of the cubemap and the light space transform (projection * view) of each face, everything is rendered again when
+	// the light moves
+	void setLight(const glm::vec3& lightPos, const glm::mat4* faceMatrices);
+
+	// Renders everything again on the next frame (the cubemap was cleared or used for something else)
+	void invalidate();
+
+	// Clears the shadow cubemap (nothing casts shadows) and renders everything again on the next frame
+	void clear();
+
+	// Static caster for this frame: key stands for whatever decides its shadow (level of detail, ...), the faces of its
+	// bounding sphere (world space) before and after are rendered again when the key changes
+	void trackStatic(int caster, const glm::vec3& center, float radius, uint64_t key);
+
+	// Clears the dirty faces of the cached cubemap and returns them, the static casters are then drawn in each of them
+	// after bindStaticFace (0: nothing to draw, the cache is up to date)
+	unsigned int beginStatic();
+	void bindStaticFace(unsigned int face);
+
+	// Copies the cached depth to the faces the dynamic casters cover (dynamicFaces) or covered in the previous frame, and to
+	// the faces re-rendered by beginStatic. Returns those faces, the dynamic casters are then drawn in each of them after bindFace
+	unsigned int beginDynamic(unsigned int dynamicFaces);
+	void bindFace(unsigned int face);
+
+	void endFrame();
+
+	// Faces whose frustum a sphere (world space) intersects
+	unsigned int facesOf(const glm::vec3& center, float radius) const;
+
+private:
+	struct StaticCaster {
+		uint64_t key;
+		unsigned int faces;
+	};
+
+	// storage of the faces of a depth cubemap
+	static void allocate(GLuint cubemap, GLsizei size);
+	// attaches one face of a cubemap to the framebuffer of the draws
+	void attachFace(GLuint cubemap, unsigned int face);
+
+	GLuint mShadowCubemap = 0;
+	GLuint mStaticCubemap = 0;
+	GLuint mDrawFBO = 0; // one face of either cubemap
+	GLuint mReadFBO = 0; // one face of the cached cubemap, for the copies
+	GLsizei mSize = 0;
+
+	glm::vec3 mLightPos = glm::vec3(0.0f);
+	glm::vec4 mFacePlanes[6][6]; // frustum planes of each face, normals pointing inside
+	std::map<int, StaticCaster> mStaticCasters;
+	unsigned int mStaticDirty = allFaces; // faces of the cache to render again
+	unsigned int mStaticRendered = 0; // faces of the cache rendered this frame
+	unsigned int mPreviousDynamic = 0; // faces covered by the dynamic casters in the previous frame
+	unsigned int mDynamic = 0; // this frame
+};
+
+#endif
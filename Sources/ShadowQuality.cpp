@@ -0,0 +1,69 @@
+#include "ShadowQuality.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+const ShadowQuality::Tier ShadowQuality::tiers[] = {
+	{ "low", 512, 4, 2 },
+	{ "medium", 1024, 8, 1 },
+	{ "high", 1024, 20, 1 },
+	{ "ultra", 2048, 20, 1 },
+};
+const int ShadowQuality::tierCount = sizeof(tiers) / sizeof(tiers[0]);
+
+static const unsigned int lowerAfterFrames = 30; // over budget for half a second at 60 fps
+static const unsigned int raiseAfterFrames = 600; // well under budget for 10 seconds
+static const float raiseUnder = 0.75f; // part of the budget the frame time must stay under to raise the tier
+
+ShadowQuality::ShadowQuality(int tier, bool adaptive, float frameBudget) {
+	mTier = mSelectedTier = mCeiling = std::min(std::max(tier, 0), tierCount - 1);
+	mAdaptive = adaptive;
+	mFrameBudget = frameBudget;
+	mAverage = frameBudget * 0.5f;
+}
+
+void ShadowQuality::selectTier(int tier) {
+	mSelectedTier = mCeiling = std::min(std::max(tier, 0), tierCount - 1);
+	changeTier(mSelectedTier);
+	mLastChangeRaised = false;
+}
+
+void ShadowQuality::setAdaptive(bool adaptive) {
+	mAdaptive = adaptive;
+	if (!adaptive)
+		changeTier(mSelectedTier);
+	mCeiling = mSelectedTier;
+}
+
+bool ShadowQuality::frameTime(float seconds) {
+	mAverage += (seconds - mAverage) * 0.1f;
+	mFramesSinceChange++;
+	if (!mAdaptive)
+		return false;
+
+	mSlowFrames = mAverage > mFrameBudget ? mSlowFrames + 1 : 0;
+	mFastFrames = mAverage < mFrameBudget * raiseUnder ? mFastFrames + 1 : 0;
+
+	if (mSlowFrames >= lowerAfterFrames && mTier > 0) {
+		if (mLastChangeRaised && mFramesSinceChange < raiseAfterFrames)
+			mCeiling = mTier - 1; //the raised tier did not hold, stay under it
+		changeTier(mTier - 1);
+		mLastChangeRaised = false;
+		std::cout << "SHADOWS:: frame time over budget, " << tier().name << " shadows" << std::endl;
+		return true;
+	}
+	if (mFastFrames >= raiseAfterFrames && mTier < mCeiling) {
+		changeTier(mTier + 1);
+		mLastChangeRaised = true;
+		std::cout << "SHADOWS:: room in the frame budget, " << tier().name << " shadows" << std::endl;
+		return true;
+	}
+	return false;
+}
+
+void ShadowQuality::changeTier(int tier) {
+	mTier = tier;
+	mSlowFrames = 0;
+	mFastFrames = 0;
+	mFramesSinceChange = 0;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#ifndef SHADOW_QUALITY_H
+#define SHADOW_QUALITY_H
+
+#include <glad/glad.h>
+
+// Shadow quality tiers (cubemap resolution, PCF taps, how often the cubemap is updated) and the adaptive mode, which lowers
+// the tier while the frame time is over budget and raises it back, up to the selected tier, once there is room again
+class ShadowQuality {
+public:
+	struct Tier {
+		const char* name;
+		GLsizei resolution; // of each face of the depth cubemap
+		int samples; // PCF taps in shadowCalculation (SHADOW_SAMPLES of Shaders/common/shadows.glsl: 4, 8 or 20)
+		unsigned int updateInterval; // frames between two updates of the cubemap
+	};
+	static const Tier tiers[];
+	static const int tierCount;
+
+	// frameBudget in seconds
+	ShadowQuality(int tier, bool adaptive, float frameBudget);
+
+	const Tier& tier() const { return tiers[mTier]; }
+	int tierIndex() const { return mTier; }
+
+	// Selected tier, the highest the adaptive mode goes back to
+	void selectTier(int tier);
+	int selectedTier() const { return mSelectedTier; }
+
+	void setAdaptive(bool adaptive);
+	bool adaptive() const { return mAdaptive; }
+
+	// Duration (seconds) of the last frame, returns true when the adaptive mode changed the tier
+	bool frameTime(float seconds);
+
+	// Whether the cubemap is updated on that frame
+	bool updateDue(unsigned int frame) const { return frame % tier().updateInterval == 0; }
+
+private:
+	void changeTier(int tier);
+
+	int mTier;
+	int mSelectedTier;
+	int mCeiling; // highest tier the adaptive mode raises to, lowered when a raised tier did not hold
+	bool mAdaptive;
+	bool mLastChangeRaised = false;
+	float mFrameBudget;
+	float mAverage; // moving average of the frame time
+	unsigned int mSlowFrames = 0; // consecutive frames with the average over budget
+	unsigned int mFastFrames = 0; // consecutive frames with room under the budget
+	unsigned int mFramesSinceChange = 0;
+};
+
+#endif
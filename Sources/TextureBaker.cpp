@@ -0,0 +1,182 @@
+#include "TextureBaker.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+
+#include "KtxTexture.hpp"
+#include "TextureLoader.hpp"
+
+#include <stb/stb_image.h>
+// only the baker resamples and compresses images, so the implementations live here
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb/stb_image_resize.h>
+#define STB_DXT_IMPLEMENTATION
+#define STBD_MEMSET memset //the default of stb_dxt 1.07 is declared with the wrong arity
+#include <stb/stb_dxt.h>
+
+// A source image decoded with the number of components it is baked with
+struct BakeImage {
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	std::vector<unsigned char> pixels;
+	uint64_t contentHash = 0;
+};
+
+// requiredComponents = 0 keeps the components of the file (except 2 components images, expanded to RGBA)
+static bool loadBakeImage(const std::string& path, int requiredComponents, BakeImage& image) {
+	EncodedImage file = readImageFile(path);
+	if (file.bytes.empty())
+		return false;
+	int components;
+	if (!stbi_info_from_memory(file.bytes.data(), (int)file.bytes.size(), &image.width, &image.height, &components))
+		return false;
+	if (requiredComponents == 0)
+		requiredComponents = components == 2 ? 4 : components;
+	unsigned char* pixels = stbi_load_from_memory(file.bytes.data(), (int)file.bytes.size(), &image.width, &image.height, &components, requiredComponents);
+	if (!pixels)
+		return false;
+	image.components = requiredComponents;
+	image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * image.components);
+	image.contentHash = file.contentHash;
+	stbi_image_free(pixels);
+	return true;
+}
+
+// full mip chain of an image, down to 1x1. Level 0 is the image itself
+static std::vector<BakeImage> buildMipChain(const BakeImage& image) {
+	std::vector<BakeImage> chain(1, image);
+	while (chain.back().width > 1 || chain.back().height > 1) {
+		const BakeImage& previous = chain.back();
+		BakeImage level;
+		level.width = previous.width > 1 ? previous.width / 2 : 1;
+		level.height = previous.height > 1 ? previous.height / 2 : 1;
+		level.components = previous.components;
+		level.pixels.resize((size_t)level.width * level.height * level.components);
+		stbir_resize_uint8(previous.pixels.data(), previous.width, previous.height, 0, level.pixels.data(), level.width, level.height, 0, level.components);
+		chain.push_back(std::move(level));
+	}
+	return chain;
+}
+
+// appends a level to the face data: S3TC blocks when compressed, otherwise rows padded to 4 bytes as KTX requires
+static void encodeLevel(const BakeImage& level, bool compressed, std::vector<unsigned char>& output) {
+	if (!compressed) {
+		size_t rowSize = (size_t)level.width * level.components;
+		size_t paddedRowSize = (rowSize + 3) & ~(size_t)3;
+		for (int y = 0; y < level.height; y++) {
+			output.insert(output.end(), level.pixels.begin() + y * rowSize, level.pixels.begin() + (y + 1) * rowSize);
+			output.resize(output.size() + paddedRowSize - rowSize, 0);
+		}
+		return;
+	}
+	const bool alpha = level.components == 4;
+	const size_t blockSize = alpha ? 16 : 8; //DXT5 : DXT1
+	for (int blockY = 0; blockY < level.height; blockY += 4) {
+		for (int blockX = 0; blockX < level.width; blockX += 4) {
+			//4x4 RGBA block, the borders of the levels smaller than a block are clamped
+			unsigned char block[16 * 4];
+			for (int y = 0; y < 4; y++) {
+				for (int x = 0; x < 4; x++) {
+					int sourceX = blockX + x < level.width ? blockX + x : level.width - 1;
+					int sourceY = blockY + y < level.height ? blockY + y : level.height - 1;
+					const unsigned char* texel = &level.pixels[((size_t)sourceY * level.width + sourceX) * level.components];
+					unsigned char* destination = &block[(y * 4 + x) * 4];
+					destination[0] = texel[0];
+					destination[1] = texel[1];
+					destination[2] = texel[2];
+					destination[3] = alpha ? texel[3] : 255;
+				}
+			}
+			size_t offset = output.size();
+			output.resize(offset + blockSize);
+			stb_compress_dxt_block(&output[offset], block, alpha ? 1 : 0, STB_DXT_HIGHQUAL);
+		}
+	}
+}
+
+// bakes a set of faces (1 or 6) of the same size and components into a KTX file
+static bool bakeFaces(const std::vector<BakeImage>& faces, uint64_t sourceHash, const std::string& bakedPath, bool compress) {
+	const BakeImage& first = faces.front();
+	for (unsigned int i = 1; i < faces.size(); i++) {
+		if (faces[i].width != first.width || faces[i].height != first.height || faces[i].components != first.components) {
+			std::cout << "ERROR::BAKE:: the faces of " << bakedPath << " do not have the same size" << std::endl;
+			return false;
+		}
+	}
+	compress = compress && first.components >= 3;
+
+	KtxDescription texture;
+	texture.width = first.width;
+	texture.height = first.height;
+	texture.faces = (int)faces.size();
+	texture.sourceHash = sourceHash;
+	if (compress) {
+		texture.glType = 0;
+		texture.glFormat = 0;
+		texture.glInternalFormat = first.components == 4 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		texture.glBaseInternalFormat = first.components == 4 ? GL_RGBA : GL_RGB;
+	}
+	else {
+		const GLenum formats[] = { GL_RED, GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		const GLenum internalFormats[] = { GL_R8, GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+		texture.glType = GL_UNSIGNED_BYTE;
+		texture.glFormat = formats[first.components];
+		texture.glInternalFormat = internalFormats[first.components];
+		texture.glBaseInternalFormat = formats[first.components];
+	}
+
+	//levels[i] holds the faces of level i one after the other
+	std::vector<std::vector<BakeImage>> chains;
+	for (unsigned int i = 0; i < faces.size(); i++)
+		chains.push_back(buildMipChain(faces[i]));
+	std::vector<std::vector<unsigned char>> levels(chains.front().size());
+	for (unsigned int i = 0; i < levels.size(); i++) {
+		for (unsigned int face = 0; face < chains.size(); face++)
+			encodeLevel(chains[face][i], compress, levels[i]);
+		KtxLevel level;
+		level.width = chains.front()[i].width;
+		level.height = chains.front()[i].height;
+		level.data = levels[i].data();
+		level.faceSize = levels[i].size() / faces.size(); //every face size is a multiple of 4 bytes, no face padding needed
+		texture.levels.push_back(level);
+	}
+
+	if (!KtxTexture::write(bakedPath, texture)) {
+		std::cout << "ERROR::BAKE:: could not write " << bakedPath << std::endl;
+		return false;
+	}
+	size_t sourceSize = (size_t)first.width * first.height * first.components * faces.size();
+	size_t bakedSize = 0;
+	for (unsigned int i = 0; i < levels.size(); i++)
+		bakedSize += levels[i].size();
+	std::cout << "Baked " << bakedPath << ": " << texture.levels.size() << " levels, " << (compress ? "S3TC" : "uncompressed")
+		<< ", " << bakedSize / 1024 << " KB in VRAM instead of " << sourceSize * 4 / 3 / 1024 << " KB" << std::endl;
+	return true;
+}
+
+bool TextureBaker::bake2D(const std::string& sourcePath, bool compress) {
+	std::vector<BakeImage> faces(1);
+	if (!loadBakeImage(sourcePath, 0, faces[0])) {
+		std::cout << "ERROR::BAKE:: could not read " << sourcePath << std::endl;
+		return false;
+	}
+	return bakeFaces(faces, faces[0].contentHash, KtxTexture::bakedPath(sourcePath), compress);
+}
+
+bool TextureBaker::bakeCubeMap(const std::vector<std::string>& facePaths, const std::string& bakedPath, bool compress) {
+	//cubemap faces are always uploaded as RGBA, like createCubeMapTexture does
+	std::vector<BakeImage> faces(facePaths.size());
+	std::vector<uint64_t> faceHashes;
+	for (unsigned int i = 0; i < facePaths.size(); i++) {
+		if (!loadBakeImage(facePaths[i], 4, faces[i])) {
+			std::cout << "ERROR::BAKE:: could not read " << facePaths[i] << std::endl;
+			return false;
+		}
+		faceHashes.push_back(faces[i].contentHash);
+	}
+	//same hash as a cubemap created from its faces at runtime (see createCubeMapTexture)
+	uint64_t sourceHash = hashBytes(faceHashes.data(), faceHashes.size() * sizeof(uint64_t));
+	return bakeFaces(faces, sourceHash, bakedPath, compress);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#ifndef TEXTURE_BAKER_H
+#define TEXTURE_BAKER_H
+
+#include <string>
+#include <vector>
+
+// Offline conversion of source images (png, jpg...) into KTX files holding the whole mip chain (see KtxTexture).
+// Run through the --bake-textures command line mode, never while rendering: it is slow (resampling and block compression)
+class TextureBaker {
+public:
+	// Bakes an image into KtxTexture::bakedPath(sourcePath). With compress, RGB images are stored as DXT1 and RGBA ones as DXT5
+	// (single channel images are always stored as is). Returns false if the image could not be read or the file written
+	static bool bake2D(const std::string& sourcePath, bool compress);
+
+	// Bakes the 6 faces of a cubemap (+X -X +Y -Y +Z -Z, same size) into one KTX file
+	static bool bakeCubeMap(const std::vector<std::string>& facePaths, const std::string& bakedPath, bool compress);
+};
+
+#endif
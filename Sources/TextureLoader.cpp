@@ -0,0 +1,97 @@
+#include "TextureLoader.hpp"
+
+#include <fstream>
+#include <iostream>
+
+// the implementation of stb_image lives in main.cpp (see glitter.hpp)
+#include <stb/stb_image.h>
+
+uint64_t hashBytes(const void* data, size_t size) {
+	const unsigned char* bytes = (const unsigned char*)data;
+	uint64_t hash = 14695981039346656037ull; //FNV offset basis
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ull; //FNV prime
+	}
+	return hash;
+}
+
+EncodedImage readImageFile(const std::string& path) {
+	EncodedImage file;
+	file.path = path;
+	std::ifstream stream(path, std::ios::binary | std::ios::ate);
+	if (!stream)
+		return file;
+	std::streamoff size = stream.tellg();
+	if (size <= 0)
+		return file;
+	file.bytes.resize((size_t)size);
+	stream.seekg(0);
+	if (!stream.read((char*)file.bytes.data(), size)) {
+		file.bytes.clear();
+		return file;
+	}
+	file.contentHash = hashBytes(file.bytes.data(), file.bytes.size());
+	return file;
+}
+
+DecodedImage decodeImage(const EncodedImage& file) {
+	DecodedImage image;
+	image.path = file.path;
+	image.contentHash = file.contentHash;
+	if (!file.bytes.empty())
+		image.pixels = stbi_load_from_memory(file.bytes.data(), (int)file.bytes.size(), &image.width, &image.height, &image.components, 0);
+	return image;
+}
+
+DecodedImage decodeImage(const std::string& path) {
+	return decodeImage(readImageFile(path));
+}
+
+void freeImage(DecodedImage& image) {
+	stbi_image_free(image.pixels);
+	image.pixels = nullptr;
+}
+
+GLenum imageFormat(const DecodedImage& image) {
+	GLenum format{};
+	if (image.components == 1)
+		format = GL_RED;
+	else if (image.components == 3)
+		format = GL_RGB;
+	else if (image.components == 4)
+		format = GL_RGBA;
+	return format;
+}
+
+void setTexture2DImage(GLuint textureID, const DecodedImage& image, const void* pixels) {
+	GLenum format = imageFormat(image);
+
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // stb_image rows are tightly packed
+	glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glGenerateMipmap(GL_TEXTURE_2D); // generate the mipmaps
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture when done, so we won't accidently mess up our texture.
+}
+
+GLuint uploadTexture2D(const DecodedImage& image) {
+	GLuint textureID;
+	glGenTextures(1, &textureID);
+
+	if (image.pixels)
+	{
+		setTexture2DImage(textureID, image, image.pixels);
+		std::cout << "Texture loaded at path: " << image.path << std::endl;
+	}
+	else
+	{
+		std::cout << "Texture failed to load at path: " << image.path << std::endl;
+	}
+	return textureID;
+}
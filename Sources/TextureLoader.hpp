@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glad/glad.h>
+
+// Raw bytes of an image file (png, jpg...) read on the CPU side, with the hash of its content.
+// The file is read once: the hash identifies the image for deduplication and the bytes are then decoded from memory
+struct EncodedImage {
+	std::string path;
+	std::vector<unsigned char> bytes; //empty if the file could not be read
+	uint64_t contentHash = 0;
+};
+
+// Pixels of an image decoded on the CPU side (on any thread), waiting to be uploaded to a texture on the GL thread
+struct DecodedImage {
+	std::string path;
+	int width = 0;
+	int height = 0;
+	int components = 0;
+	unsigned char* pixels = nullptr; //null if the image failed to load
+	uint64_t contentHash = 0; //hash of the encoded file, see EncodedImage
+};
+
+// 64 bit FNV-1a hash of a block of memory
+uint64_t hashBytes(const void* data, size_t size);
+
+// Reads an image file and hashes its content. Thread safe
+EncodedImage readImageFile(const std::string& path);
+
+// Decodes an image read by readImageFile with stb_image. Thread safe
+DecodedImage decodeImage(const EncodedImage& file);
+
+// Reads and decodes an image file with stb_image. Thread safe
+DecodedImage decodeImage(const std::string& path);
+
+// Releases the pixels of a decoded image
+void freeImage(DecodedImage& image);
+
+// GL format matching the number of components of a decoded image
+GLenum imageFormat(const DecodedImage& image);
+
+// Size in bytes of the pixels of a decoded image
+inline size_t imageByteSize(const DecodedImage& image) { return (size_t)image.width * image.height * image.components; }
+
+// (Re)defines the image of an existing texture as mipmapped and repeating (GL thread only).
+// pixels is either client memory or an offset in the bound GL_PIXEL_UNPACK_BUFFER
+void setTexture2DImage(GLuint textureID, const DecodedImage& image, const void* pixels);
+
+// Creates a mipmapped repeating 2D texture from a decoded image (GL thread only).
+// A texture name is always returned, even if the image failed to load, like the previous loaders did
+GLuint uploadTexture2D(const DecodedImage& image);
+
+#endif
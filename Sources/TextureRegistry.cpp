@@ -0,0 +1,128 @@
+#include "TextureRegistry.hpp"
+
+#include <iostream>
+#include <utility>
+
+#include "KtxTexture.hpp"
+
+TextureRegistry& TextureRegistry::instance() {
+	static TextureRegistry registry;
+	return registry;
+}
+
+GLuint TextureRegistry::acquire2D(const std::string& path, TextureStreamer* streamer, const glm::vec4& placeholder) {
+	GLuint texture = find(path);
+	if (!texture)
+		texture = acquireBaked(path, KtxTexture::bakedPath(path), std::vector<std::string>(1, path));
+	if (texture)
+		return texture;
+	return acquire2D(readImageFile(path), streamer, placeholder);
+}
+
+GLuint TextureRegistry::acquire2D(EncodedImage file, TextureStreamer* streamer, const glm::vec4& placeholder) {
+	GLuint texture = find(file.path);
+	if (!texture && file.contentHash)
+		texture = findContent(file.contentHash, file.path);
+	if (texture)
+		return texture;
+
+	std::string path = file.path;
+	uint64_t contentHash = file.contentHash;
+	if (streamer) {
+		texture = streamer->request(std::move(file), placeholder);
+	}
+	else {
+		DecodedImage image = decodeImage(file);
+		texture = uploadTexture2D(image);
+		freeImage(image);
+	}
+	add(path, contentHash, texture);
+	return texture;
+}
+
+GLuint TextureRegistry::acquire2D(const DecodedImage& image) {
+	GLuint texture = find(image.path);
+	if (!texture && image.contentHash)
+		texture = findContent(image.contentHash, image.path);
+	if (texture)
+		return texture;
+
+	texture = uploadTexture2D(image);
+	add(image.path, image.contentHash, texture);
+	return texture;
+}
+
+GLuint TextureRegistry::acquireBaked(const std::string& key, const std::string& bakedPath, const std::vector<std::string>& sourcePaths) {
+	GLuint texture = find(key);
+	if (texture || !KtxTexture::isUpToDate(bakedPath, sourcePaths))
+		return texture;
+
+	MappedFile file;
+	KtxDescription baked;
+	if (!file.open(bakedPath) || !KtxTexture::read(file, baked)) {
+		std::cout << "ERROR::KTX:: invalid baked texture, using the source instead: " << bakedPath << std::endl;
+		return 0;
+	}
+	//the source hash is stored in the file, so a baked image is shared with the same image loaded from anywhere else
+	if (baked.sourceHash) {
+		texture = findContent(baked.sourceHash, key);
+		if (texture)
+			return texture;
+	}
+	texture = KtxTexture::upload(baked);
+	if (!texture)
+		return 0;
+	std::cout << "Texture loaded at path: " << bakedPath << std::endl;
+	add(key, baked.sourceHash, texture);
+	return texture;
+}
+
+GLuint TextureRegistry::find(const std::string& key) {
+	std::unordered_map<std::string, GLuint>::iterator it = mByKey.find(key);
+	if (it == mByKey.end())
+		return 0;
+	mEntries[it->second].references++;
+	return it->second;
+}
+
+GLuint TextureRegistry::findContent(uint64_t contentHash, const std::string& key) {
+	std::unordered_map<uint64_t, GLuint>::iterator it = mByContent.find(contentHash);
+	if (it == mByContent.end())
+		return 0;
+	Entry& entry = mEntries[it->second];
+	entry.references++;
+	entry.keys.push_back(key);
+	mByKey[key] = it->second;
+	std::cout << "Texture shared by content: " << key << " is the same image as " << entry.keys.front() << std::endl;
+	return it->second;
+}
+
+void TextureRegistry::add(const std::string& key, uint64_t contentHash, GLuint texture) {
+	Entry& entry = mEntries[texture];
+	entry.contentHash = contentHash;
+	entry.references = 1;
+	entry.keys.push_back(key);
+	mByKey[key] = texture;
+	if (contentHash)
+		mByContent[contentHash] = texture;
+}
+
+void TextureRegistry::release(GLuint texture) {
+	std::unordered_map<GLuint, Entry>::iterator it = mEntries.find(texture);
+	if (it == mEntries.end())
+		return;
+	Entry& entry = it->second;
+	if (--entry.references > 0)
+		return;
+	for (unsigned int i = 0; i < entry.keys.size(); i++)
+		mByKey.erase(entry.keys[i]);
+	if (entry.contentHash)
+		mByContent.erase(entry.contentHash);
+	mEntries.erase(it);
+	glDeleteTextures(1, &texture);
+}
+
+unsigned int TextureRegistry::referenceCount(GLuint texture) const {
+	std::unordered_map<GLuint, Entry>::const_iterator it = mEntries.find(texture);
+	return it == mEntries.end() ? 0 : it->second.references;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#ifndef TEXTURE_REGISTRY_H
+#define TEXTURE_REGISTRY_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "TextureLoader.hpp"
+#include "TextureStreamer.hpp"
+
+// Process-wide registry of the textures loaded from files, shared by every model and by main.
+// A texture is looked up by path first (hashed), then by the hash of its file content so that the same image
+// stored under several paths is only decoded and uploaded once. Every acquire must be balanced by a release,
+// the texture is deleted with its last reference. GL thread only
+class TextureRegistry {
+public:
+	static TextureRegistry& instance();
+
+	// 2D texture of an image file, read here if nobody uses this path yet. An up to date baked version of the image (see KtxTexture) is preferred
+	GLuint acquire2D(const std::string& path, TextureStreamer* streamer = nullptr, const glm::vec4& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+	// 2D texture of an image file already read by the caller (e.g. on a worker thread).
+	// With a streamer the image is decoded and uploaded in the background, otherwise right away
+	GLuint acquire2D(EncodedImage file, TextureStreamer* streamer = nullptr, const glm::vec4& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+	// 2D texture of an image already decoded by the caller, the pixels stay owned by the caller
+	GLuint acquire2D(const DecodedImage& image);
+
+	// texture of a baked KTX file (2D or cubemap) registered under key, if the file is newer than all its sources.
+	// Returns 0 if there is no up to date baked file or if the driver does not support its format
+	GLuint acquireBaked(const std::string& key, const std::string& bakedPath, const std::vector<std::string>& sourcePaths);
+
+	// lower level access, for the textures the registry does not know how to create (e.g. cubemaps).
+	// find and findContent return 0 when nothing matches, and take a reference otherwise (findContent also registers the key as an alias)
+	GLuint find(const std::string& key);
+	GLuint findContent(uint64_t contentHash, const std::string& key);
+	// registers a texture created by the caller, with a first reference
+	void add(const std::string& key, uint64_t contentHash, GLuint texture);
+
+	void release(GLuint texture);
+
+	unsigned int referenceCount(GLuint texture) const;
+	size_t size() const { return mEntries.size(); }
+
+	TextureRegistry(const TextureRegistry&) = delete;
+	TextureRegistry& operator=(const TextureRegistry&) = delete;
+private:
+	TextureRegistry() {}
+
+	struct Entry {
+		uint64_t contentHash = 0; //0 when unknown (file that could not be read)
+		unsigned int references = 0;
+		std::vector<std::string> keys; //every path this texture was requested with
+	};
+
+	std::unordered_map<std::string, GLuint> mByKey;
+	std::unordered_map<uint64_t, GLuint> mByContent;
+	std::unordered_map<GLuint, Entry> mEntries;
+};
+
+#endif
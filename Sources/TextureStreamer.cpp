@@ -0,0 +1,144 @@
+#include "TextureStreamer.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+TextureStreamer::TextureStreamer(ThreadPool& pool, size_t stagingSize) :
+	mPool(pool), mNextSegment(0), mStagingSize(stagingSize), mPersistent(false), mStagingCreated(false) {
+}
+
+TextureStreamer::~TextureStreamer() {
+	for (unsigned int i = 0; i < mPending.size(); i++) {
+		PendingTexture& pending = mPending[i];
+		if (!pending.decoded)
+			pending.image = pending.decoding.get();
+		freeImage(pending.image);
+	}
+}
+
+GLuint TextureStreamer::request(const std::string& path, const glm::vec4& placeholder) {
+	GLuint texture = createPlaceholder(placeholder);
+	PendingTexture pending;
+	pending.texture = texture;
+	pending.decoding = mPool.submit([path]() { return decodeImage(path); });
+	mPending.push_back(std::move(pending));
+	return texture;
+}
+
+GLuint TextureStreamer::request(EncodedImage file, const glm::vec4& placeholder) {
+	//shared so that the task stays copyable without copying the file bytes
+	std::shared_ptr<EncodedImage> encoded = std::make_shared<EncodedImage>(std::move(file));
+	GLuint texture = createPlaceholder(placeholder);
+	PendingTexture pending;
+	pending.texture = texture;
+	pending.decoding = mPool.submit([encoded]() { return decodeImage(*encoded); });
+	mPending.push_back(std::move(pending));
+	return texture;
+}
+
+GLuint TextureStreamer::createPlaceholder(const glm::vec4& placeholder) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+
+	//the placeholder is a single texel so that the texture can be sampled right away
+	unsigned char texel[4];
+	for (int i = 0; i < 4; i++)
+		texel[i] = (unsigned char)(glm::clamp(placeholder[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return texture;
+}
+
+void TextureStreamer::update(size_t byteBudget) {
+	if (!mStagingCreated)
+		createStagingBuffers();
+
+	size_t uploadedBytes = 0;
+	bool first = true;
+	for (std::deque<PendingTexture>::iterator it = mPending.begin(); it != mPending.end();) {
+		//never waits on a decode: the images not ready yet are left for the next frames
+		if (!it->decoded) {
+			if (it->decoding.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+				++it;
+				continue;
+			}
+			it->image = it->decoding.get();
+			it->decoded = true;
+		}
+		DecodedImage& image = it->image;
+		if (!image.pixels) {
+			std::cout << "Texture failed to load at path: " << image.path << std::endl; //the placeholder stays
+			it = mPending.erase(it);
+			continue;
+		}
+		size_t size = imageByteSize(image);
+		if (!first && uploadedBytes + size > byteBudget) //the upload of this one would blow the budget: next frame
+			break;
+
+		if (size <= mStagingSize) {
+			StagingSegment* segment = acquireSegment();
+			if (!segment) //the GPU is still reading every staging buffer, try again next frame
+				break;
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, segment->buffer);
+			if (mPersistent) {
+				memcpy(segment->mapped, image.pixels, size); //coherent mapping, no flush needed
+			}
+			else {
+				//the fence of the segment was signaled, so nothing reads it anymore and the mapping does not need to be synchronized
+				void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+				memcpy(mapped, image.pixels, size);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+			}
+			setTexture2DImage(it->texture, image, (const void*)0); //reads from the bound pixel buffer
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			segment->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		else {
+			setTexture2DImage(it->texture, image, image.pixels); //too big for a staging buffer
+		}
+		std::cout << "Texture loaded at path: " << image.path << std::endl;
+
+		freeImage(image);
+		uploadedBytes += size;
+		first = false;
+		it = mPending.erase(it);
+	}
+}
+
+void TextureStreamer::createStagingBuffers() {
+	mStagingCreated = true;
+	mPersistent = GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage;
+	for (int i = 0; i < STAGING_SEGMENT_COUNT; i++) {
+		StagingSegment& segment = mSegments[i];
+		glGenBuffers(1, &segment.buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, segment.buffer);
+		if (mPersistent) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_PIXEL_UNPACK_BUFFER, mStagingSize, nullptr, flags);
+			segment.mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, mStagingSize, flags);
+		}
+		else {
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, mStagingSize, nullptr, GL_STREAM_DRAW);
+		}
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+TextureStreamer::StagingSegment* TextureStreamer::acquireSegment() {
+	StagingSegment& segment = mSegments[mNextSegment];
+	if (segment.fence) {
+		GLenum status = glClientWaitSync(segment.fence, 0, 0);
+		if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED)
+			return nullptr;
+		glDeleteSync(segment.fence);
+		segment.fence = 0;
+	}
+	mNextSegment = (mNextSegment + 1) % STAGING_SEGMENT_COUNT;
+	return &segment;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "TextureLoader.hpp"
+#include "ThreadPool.hpp"
+
+// Streams 2D textures in the background: request() returns at once a texture showing a 1x1 placeholder color,
+// the image is decoded on the worker pool and update() uploads the decoded images through a ring of pixel buffer objects,
+// a few per frame, under a byte budget. The texture name never changes so it can be bound before the real image arrived
+class TextureStreamer {
+public:
+	// stagingSize is the size of each of the STAGING_SEGMENT_COUNT pixel buffers, bigger images are uploaded from client memory
+	TextureStreamer(ThreadPool& pool, size_t stagingSize = 16 * 1024 * 1024);
+	// waits for the decodes still running and frees their pixels. The GL objects are left to the context destruction
+	~TextureStreamer();
+
+	// creates the texture with the placeholder color (RGBA in [0,1]) and queues the decode of the image (GL thread only)
+	GLuint request(const std::string& path, const glm::vec4& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+	// same for an image file already read, only the decode is left to the pool
+	GLuint request(EncodedImage file, const glm::vec4& placeholder = glm::vec4(0.5f, 0.5f, 0.5f, 1.0f));
+
+	// uploads the images decoded so far, to be called once per frame (GL thread only).
+	// Stops when the byte budget is spent (at least one image is uploaded per call) or when every staging buffer is still in use by the GPU
+	void update(size_t byteBudget = 8 * 1024 * 1024);
+
+	// number of textures still showing their placeholder
+	size_t pendingCount() const { return mPending.size(); }
+
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+private:
+	static const int STAGING_SEGMENT_COUNT = 3;
+
+	struct PendingTexture {
+		GLuint texture;
+		std::future<DecodedImage> decoding;
+		DecodedImage image; //valid once decoding was retrieved, kept here while the upload waits for budget or staging space
+		bool decoded = false;
+	};
+
+	struct StagingSegment {
+		GLuint buffer = 0;
+		unsigned char* mapped = nullptr; //only with persistent mapping
+		GLsync fence = 0; //set after the upload reading the segment was issued
+	};
+
+	GLuint createPlaceholder(const glm::vec4& placeholder);
+	void createStagingBuffers();
+	// returns a segment the GPU is done with, or null if they are all still in use
+	StagingSegment* acquireSegment();
+	void upload(GLuint texture, const DecodedImage& image);
+
+	ThreadPool& mPool;
+	std::deque<PendingTexture> mPending;
+	StagingSegment mSegments[STAGING_SEGMENT_COUNT];
+	int mNextSegment;
+	size_t mStagingSize;
+	bool mPersistent; //ARB_buffer_storage: the segments stay mapped for the whole run
+	bool mStagingCreated;
+};
+
+#endif
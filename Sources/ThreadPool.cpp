@@ -0,0 +1,35 @@
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(unsigned int threadCount) : mStopping(false) {
+	if (threadCount == 0)
+		threadCount = std::thread::hardware_concurrency();
+	if (threadCount == 0) //hardware_concurrency may not be computable
+		threadCount = 4;
+	for (unsigned int i = 0; i < threadCount; i++)
+		mWorkers.push_back(std::thread(&ThreadPool::workerLoop, this));
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStopping = true;
+	}
+	mCondition.notify_all();
+	for (unsigned int i = 0; i < mWorkers.size(); i++)
+		mWorkers[i].join();
+}
+
+void ThreadPool::workerLoop() {
+	while (true) {
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+			if (mTasks.empty()) //only reached when stopping
+				return;
+			task = std::move(mTasks.front());
+			mTasks.pop();
+		}
+		task();
+	}
+}
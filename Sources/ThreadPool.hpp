@@ -0,0 +1,54 @@
+#pragma once
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed size pool of worker threads running CPU-only tasks (parsing, decoding...).
+// Tasks must never touch OpenGL: the context is only current on the main thread
+class ThreadPool {
+public:
+	// threadCount = 0 uses one worker per hardware thread
+	explicit ThreadPool(unsigned int threadCount = 0);
+	// Finishes the queued tasks then joins the workers
+	~ThreadPool();
+
+	// Queues a task, the returned future gives its result (or rethrows its exception) once it ran
+	template<class Task>
+	std::future<typename std::result_of<Task()>::type> submit(Task task) {
+		typedef typename std::result_of<Task()>::type Result;
+		//std::function needs a copyable callable, hence the shared packaged_task
+		std::shared_ptr<std::packaged_task<Result()>> packagedTask = std::make_shared<std::packaged_task<Result()>>(std::move(task));
+		std::future<Result> result = packagedTask->get_future();
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mTasks.push([packagedTask]() { (*packagedTask)(); });
+		}
+		mCondition.notify_one();
+		return result;
+	}
+
+	unsigned int size() const { return (unsigned int)mWorkers.size(); }
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+private:
+	void workerLoop();
+
+	std::vector<std::thread> mWorkers;
+	std::queue<std::function<void()>> mTasks;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mStopping;
+};
+
+#endif
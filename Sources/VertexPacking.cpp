@@ -0,0 +1,56 @@
+#include "VertexPacking.hpp"
+
+#include <glm/gtc/packing.hpp>
+
+#include "Mesh.hpp"
+
+VertexQuantization computeVertexQuantization(const Vertex* vertices, size_t vertexCount) {
+	VertexQuantization quantization;
+	if (vertexCount == 0)
+		return quantization;
+	glm::vec3 minimum = vertices[0].Position, maximum = vertices[0].Position;
+	for (size_t i = 1; i < vertexCount; i++) {
+		minimum = glm::min(minimum, vertices[i].Position);
+		maximum = glm::max(maximum, vertices[i].Position);
+	}
+	quantization.offset = (minimum + maximum) * 0.5f;
+	quantization.scale = glm::max((maximum - minimum) * 0.5f, glm::vec3(1e-6f)); //flat meshes keep a non zero scale
+	return quantization;
+}
+
+glm::vec2 octEncode(glm::vec3 direction) {
+	float length = fabsf(direction.x) + fabsf(direction.y) + fabsf(direction.z);
+	if (length == 0.0f)
+		return glm::vec2(0.0f, 0.0f); //decodes to +Z
+	direction /= length;
+	glm::vec2 encoded(direction.x, direction.y);
+	if (direction.z < 0.0f) { //the lower hemisphere is folded over the diagonals
+		encoded.x = (1.0f - fabsf(direction.y)) * (direction.x >= 0.0f ? 1.0f : -1.0f);
+		encoded.y = (1.0f - fabsf(direction.x)) * (direction.y >= 0.0f ? 1.0f : -1.0f);
+	}
+	return encoded;
+}
+
+void packVertices(const Vertex* vertices, size_t vertexCount, const VertexQuantization& quantization, std::vector<PackedVertex>& packed) {
+	packed.resize(vertexCount);
+	for (size_t i = 0; i < vertexCount; i++) {
+		const Vertex& vertex = vertices[i];
+		PackedVertex& out = packed[i];
+		glm::vec3 position = (vertex.Position - quantization.offset) / quantization.scale;
+		out.Position[0] = (int16_t)glm::packSnorm1x16(position.x);
+		out.Position[1] = (int16_t)glm::packSnorm1x16(position.y);
+		out.Position[2] = (int16_t)glm::packSnorm1x16(position.z);
+		//handedness of the tangent frame, meshes without tangents (all zero) end up with +1
+		float handedness = glm::dot(glm::cross(vertex.Normal, vertex.Tangent), vertex.Bitangent) < 0.0f ? -1.0f : 1.0f;
+		out.Position[3] = (int16_t)glm::packSnorm1x16(handedness);
+
+		glm::vec2 normal = octEncode(vertex.Normal);
+		out.Normal[0] = (int16_t)glm::packSnorm1x16(normal.x);
+		out.Normal[1] = (int16_t)glm::packSnorm1x16(normal.y);
+		out.TexCoords[0] = glm::packHalf1x16(vertex.TexCoords.x);
+		out.TexCoords[1] = glm::packHalf1x16(vertex.TexCoords.y);
+		glm::vec2 tangent = octEncode(vertex.Tangent);
+		out.Tangent[0] = (int16_t)glm::packSnorm1x16(tangent.x);
+		out.Tangent[1] = (int16_t)glm::packSnorm1x16(tangent.y);
+	}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef VERTEX_PACKING_H
+#define VERTEX_PACKING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct Vertex;
+
+// Quantized vertex layout: 20 bytes instead of the 56 of Vertex, decoded in the vertex shaders (uniform packedVertices)
+struct PackedVertex {
+	int16_t Position[4]; // snorm16 in the bounding box of the mesh (see VertexQuantization), w holds the sign of the bitangent
+	int16_t Normal[2]; // octahedral encoding, snorm16
+	uint16_t TexCoords[2]; // half floats (keeps the coordinates outside [0,1] of repeating textures)
+	int16_t Tangent[2]; // octahedral encoding, snorm16. The bitangent is rebuilt as sign * cross(normal, tangent)
+};
+
+// Bounding box of a mesh used to decode its positions: position = packed * scale + offset
+struct VertexQuantization {
+	glm::vec3 offset = glm::vec3(0.0f);
+	glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// Bounding box quantization of a set of vertices
+VertexQuantization computeVertexQuantization(const Vertex* vertices, size_t vertexCount);
+
+// Packs vertices in the quantized layout
+void packVertices(const Vertex* vertices, size_t vertexCount, const VertexQuantization& quantization, std::vector<PackedVertex>& packed);
+
+// Octahedral encoding of a unit vector in [-1,1]^2 (decoded by octDecode in the shaders)
+glm::vec2 octEncode(glm::vec3 direction);
+
+#endif
@@ -6,18 +6,35 @@
 #include <GLFW/glfw3.h>
 
 // Standard Headers
+#include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <iostream> 
 #include <fstream>
+#include <string>
 #include <vector>
 #include <errno.h>
 #include "Shader.hpp"
 #include "Model.hpp"
+#include "AsteroidRing.hpp"
+#include "AsteroidStreamer.hpp"
+#include "OrbitingInstances.hpp"
 #include "Camera.hpp"
+#include "InstanceCuller.hpp"
+#include "InstanceTransform.hpp"
 #include "LightSource.h"
 #include "Jumper.hpp"
 #include "ParticleGenerator.h"
+#include "SceneUniforms.hpp"
+#include "ShaderReloader.hpp"
+#include "ShadowCache.hpp"
+#include "ShadowQuality.hpp"
+#include "KtxTexture.hpp"
+#include "TextureBaker.hpp"
+#include "TextureLoader.hpp"
+#include "TextureRegistry.hpp"
+#include "TextureStreamer.hpp"
+#include "ThreadPool.hpp"
 using namespace std;
 
 //matrices
@@ -48,14 +65,16 @@ void printMatrix(glm::mat4 m);
 void printVec3(glm::vec3 v);
 void showFPS(void);
 GLuint loadTexture(char const* path);
+int bakeTextures(int argc, char* argv[]);
 bool showFPSBool = false;
 
 //VAO Creations
 GLuint createAxisVAO(void);
 GLuint createCubeMapVAO(void);
-GLuint createCubeMapTexture(void);
+GLuint createCubeMapTexture(std::vector<std::future<DecodedImage>>& faces);
+std::string cubeMapKey(const std::vector<std::string>& facePaths);
 GLuint createStarsVAO(int* starsCount);
-void createAsteroidVAO(int asteroidAmount, Model asteroidModel, glm::vec3 planetPos);
+void createAsteroidVAO(const Model& asteroidModel);
 GLuint createFramebufferQuadVAO(void);
 
 //draw calls
@@ -73,13 +92,31 @@ void drawStars();
 void drawLightBulb(glm::vec4 position);
 void drawJumperOutlining();
 
-void drawPlanetShadow();
-void drawAsteroidsShadow();
-void drawMissileShadow();
-void drawJumperShadow();
-void drawWeirdCubesShadow();
-void drawStargateShadow();
-void drawLightBulbShadow(glm::vec4 position);
+//shadow pass, face by face of the cubemap (see ShadowCache): the static casters are drawn in the faces of the cache, the
+//moving ones are added to shadowCasters then drawn in the faces they reach
+void setShadowFace(const glm::mat4& shadowMatrix);
+void trackStaticShadowCasters();
+void drawPlanetShadow(unsigned int face);
+void drawAsteroidsShadow(const glm::mat4& shadowProj, const glm::mat4& faceView, const glm::vec3& lightPos);
+void addMissileShadow();
+void addJumperShadow();
+void addWeirdCubesShadow();
+void addStargateShadow();
+void addLightBulbShadow(glm::vec4 position);
+void addShadowCaster(Model& model, const glm::mat4& modelMatrix, bool cullFaces, unsigned int lod = 0);
+void drawShadowCasters(unsigned int face);
+glm::mat4 planetShadowMatrix();
+unsigned int planetShadowLod();
+void applyShadowQuality();
+
+//light list of a lit object, culled against its bounding sphere
+void bindLightsFor(const Model& model, const glm::mat4& modelMatrix);
+
+//shader variants (#defines) selected by the current settings
+std::vector<std::string> planetDefines();
+std::vector<std::string> lightingDefines(std::vector<std::string> defines);
+void selectLitShaders();
+std::vector<std::string> postEffectDefines();
 
 //movements
 void movementHandler();
@@ -138,6 +175,7 @@ int edgeDetection = 0;
 //lights
 vector<LightSource*> lightArray; //array of pointers to all light sources. REMEMBER TO DELETE POINTERS AS I DELETE THE OBJECTS
 int lightCounter = 0;
+SceneUniforms sceneUniforms; //camera and light uniform buffers shared by the programs
 
 //jumper
 Jumper jumper1;
@@ -184,7 +222,19 @@ float distanceSun = 0.0f;
 float angleSunFOV = 0.0f;
 
 //asteroids
-unsigned int asteroidAmount = 10000; //best looking results are 10000 but cpu expensive even with instancing
+AsteroidRing::Parameters asteroidRing; //seed, count (best looking results are 10000, millions stream within the budget), profile and sizes
+unsigned int asteroidBudget = 65536; //most asteroids resident at once (32 bytes per instance and buffer part), the nearest cells of the ring
+AsteroidStreamer asteroidStreamer; //cells of the ring around the camera, turning around the planet, each asteroid tumbling on its own axis
+const bool gpuAsteroidCulling = true; //transform feedback culling when the context has GL 4.4, SSE culling on the CPU otherwise
+InstanceCuller asteroidCuller; //visible asteroids, grouped by level of detail in the instance buffer of each draw
+glm::vec3 asteroidFieldCenter = glm::vec3(0.0f); //bounding sphere of all the asteroids
+float asteroidFieldRadius = 0.0f;
+
+//levels of detail
+float lodPixelError = 1.0f; //largest error on screen (pixels) a simplified level may show
+
+//lighting
+bool clusteredLighting = true; //lights binned in view space clusters (scales to hundreds of lights) rather than the 10 reaching each object
 
 //weird cube
 int weirdCubeNormalMapping = 1;
@@ -193,7 +243,8 @@ float weirdCubeAngle = 0.0f;
 //Shaders
 Shader axisShader, skyboxShader, stargateShader, waterPlaneStargateShader, jumperShader, modelOutliningShader, planetShader,
 sunShader, asteroidShader, starsShader, missileShader, lightShader, particleShader, lightBulbCenterShader, lightBulbGlassShader,
-weirdCubeShader, framebufferShader, shadowShader;
+weirdCubeShader, framebufferShader, shadowShader, asteroidShadowShader;
+Shader modelShaderBase, missileShaderBase, weirdCubeShaderBase; //lit programs, their variants are selected by selectLitShaders
 
 //Textures
 GLuint skyboxTexture, jumperReflectionMap, sunTexture, weirdCubeNormalMapTexture;
@@ -205,6 +256,30 @@ GLuint AxisVAO, skyboxVAO, starsVAO, quadVAO;
 Model StargateModel, waterPlaneStargateModel, JumperModel, PlanetModel, AsteroidModel, SunModel, missileModel, lightBulbCenterModel,
 lightBulbGlassModel, weirdCubeModel;
 
+//Asset files (also the list of what --bake-textures bakes)
+struct ModelAsset {
+	Model* model;
+	const char* path;
+	bool packedVertices; //quantized vertex format, only for models whose shaders decode it (model.vert, planet.vert, asteroid.vert)
+};
+const ModelAsset modelAssets[] = {
+	{ &StargateModel, "Models/Stargate.obj", true }, //Stargate
+	{ &waterPlaneStargateModel, "Models/waterPlaneStargate.obj", false },
+	{ &JumperModel, "Models/Jumper.obj", false },
+	{ &PlanetModel, "Models/planet.obj", true },
+	{ &AsteroidModel, "Models/rock.obj", true },
+	{ &SunModel, "Models/Sun.obj", false },
+	{ &missileModel, "Models/missile.obj", false },
+	{ &lightBulbCenterModel, "Models/lightBulbCenter.obj", false },
+	{ &lightBulbGlassModel, "Models/lightBulbGlass.obj", false },
+	{ &weirdCubeModel, "Models/weirdCube.obj", false }
+};
+const char* skyboxFacePaths[] = { "CubeMap/posx.png", "CubeMap/negx.png", "CubeMap/posy.png", "CubeMap/negy.png", "CubeMap/posz.png", "CubeMap/negz.png" }; // Must be 6 images
+const char* skyboxBakedPath = "CubeMap/skybox.ktx";
+const char* jumperReflectionMapPath = "Models/reflectionMapJumper.png";
+const char* sunTexturePath = "Models/2k_sun.jpg";
+const char* weirdCubeNormalMapPath = "Models/weirdCubeNormalMap.png";
+
 //particles
 ParticleGenerator* Particles;
 
@@ -219,12 +294,28 @@ float near_plane = 1.0f;
 float far_plane = 600.0f;
 unsigned int depthCubemap;
 bool shadowBool = true;
+ShadowCache shadowCache; //static casters cached, only the faces reached by the moving ones are drawn each frame
+enum StaticShadowCaster { PLANET_SHADOW };
+struct ShadowCaster { //moving shadow caster of the frame
+	Model* model;
+	glm::mat4 modelMatrix;
+	unsigned int lod;
+	bool cullFaces; //off for the Blender models whose triangles are not all in the same direction
+	unsigned int faces; //of the shadow cubemap it reaches
+};
+std::vector<ShadowCaster> shadowCasters;
+ShadowQuality shadowQuality(2, false, 1.0f / 50.0f); //high tier, adaptive mode (20 ms budget) toggled with numpad 0
+unsigned int shadowFrame = 0; //frames with shadows, the low tier updates the cubemap every other one
 
 
 //////////////////////////////////////////
 ////   MAIN MAIN MAIN MAIN MAIN MAIN   ///
 //////////////////////////////////////////
 int main(int argc, char* argv[]) {
+	//offline mode: bakes the textures into KTX files and exits (see bakeTextures)
+	if (argc > 1 && std::string(argv[1]) == "--bake-textures")
+		return bakeTextures(argc, argv);
+
 	//sound to loop during the whole game
 	ISound* music = SoundEngine->play2D("audio/MF-W-90.XM", true, false, true, ESM_AUTO_DETECT, true);
 	ISoundEffectControl* fx = music->getSoundEffectControl();
@@ -288,27 +379,46 @@ int main(int argc, char* argv[]) {
 	glEnable(GL_STENCIL_TEST);
 	glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE); //do nothing if stencil and depth tests fail (keep values) but replace with 1's if succeed
 
-	//Shaders
+	//Assets: all the models are parsed (mesh cache or Assimp) and all the images decoded concurrently on a worker pool.
+	//Only the GL uploads are done on this thread, once each asset is ready. The work starts now so that it overlaps the shaders compilation.
+	//The 2D textures are streamed: they show a placeholder color until the streamer uploads them, a few per frame, once the rendering started
+	ThreadPool loaderPool;
+	ThreadPool framePool; //per frame CPU work (asteroid orbits), apart from the loading tasks that would hold it up
+	TextureStreamer textureStreamer(loaderPool);
+
+	//the skybox faces are only decoded when there is no up to date baked cubemap
+	std::vector<std::string> skyboxFaceList(skyboxFacePaths, skyboxFacePaths + 6);
+	std::vector<std::future<DecodedImage>> skyboxFaces;
+	if (!KtxTexture::isUpToDate(skyboxBakedPath, skyboxFaceList)) {
+		for (const char* facePath : skyboxFacePaths)
+			skyboxFaces.push_back(loaderPool.submit([facePath]() { return decodeImage(facePath); }));
+	}
+
+	std::vector<std::future<void>> modelsLoading;
+	for (const ModelAsset& asset : modelAssets) {
+		Model* model = asset.model;
+		const char* path = asset.path;
+		modelsLoading.push_back(loaderPool.submit([model, path]() { model->load(path, false); })); //textures streamed by upload()
+	}
+
+	//Shaders (the shared uniform buffers first, their blocks are bound when each program is linked)
+	sceneUniforms.create(clusteredLighting);
+	clusteredLighting = sceneUniforms.clustered(); //per object light lists on drivers without the texture units of the clusters
 	axisShader = Shader("Shaders/axis.vert", "Shaders/axis.frag");
 	axisShader.compile();
 
 	skyboxShader = Shader("Shaders/skybox.vert", "Shaders/skybox.frag");
 	skyboxShader.compile();
 
-	stargateShader = Shader("Shaders/model.vert", "Shaders/model.frag", "Shaders/model.geom");
-	stargateShader.compile();
+	modelShaderBase = Shader("Shaders/model.vert", "Shaders/model.frag", "Shaders/model.geom");
 
 	waterPlaneStargateShader = Shader("Shaders/waterPlaneStargate.vert", "Shaders/waterPlaneStargate.frag");
 	waterPlaneStargateShader.compile();
 
-	jumperShader = Shader("Shaders/model.vert", "Shaders/model.frag", "Shaders/model.geom");
-	jumperShader.compile();
-
 	modelOutliningShader = Shader("Shaders/modelOutlining.vert", "Shaders/modelOutlining.frag");
 	modelOutliningShader.compile();
 
 	planetShader = Shader("Shaders/planet.vert", "Shaders/planet.frag"); 
-	planetShader.compile();
 
 	sunShader = Shader("Shaders/sun.vert", "Shaders/sun.frag");
 	sunShader.compile();
@@ -319,8 +429,7 @@ int main(int argc, char* argv[]) {
 	starsShader = Shader("Shaders/stars.vert", "Shaders/stars.frag");
 	starsShader.compile();
 	
-	missileShader = Shader("Shaders/missile.vert", "Shaders/missile.frag");
-	missileShader.compile();
+	missileShaderBase = Shader("Shaders/missile.vert", "Shaders/missile.frag");
 
 	lightShader = Shader("Shaders/lightSource.vert", "Shaders/lightSource.frag");
 	lightShader.compile();
@@ -334,21 +443,37 @@ int main(int argc, char* argv[]) {
 	lightBulbGlassShader = Shader("Shaders/lightBulbGlass.vert", "Shaders/lightBulbGlass.frag");
 	lightBulbGlassShader.compile();
 
-	weirdCubeShader = Shader("Shaders/weirdCube.vert", "Shaders/weirdCube.frag");
-	weirdCubeShader.compile();
+	weirdCubeShaderBase = Shader("Shaders/weirdCube.vert", "Shaders/weirdCube.frag");
+	selectLitShaders(); //variants of the lighting and shadow quality settings
 
 	framebufferShader = Shader("Shaders/framebuffer.vert", "Shaders/framebuffer.frag");
 	framebufferShader.compile();
+	framebufferShader.variant({ "GRAYSCALE" }); //one variant per post-processing effect
+	framebufferShader.variant({ "KERNEL_SHARPEN" });
+	framebufferShader.variant({ "KERNEL_BLUR" });
+	framebufferShader.variant({ "KERNEL_EDGE_DETECTION" });
 
-	shadowShader = Shader("Shaders/shadowShader.vert", "Shaders/shadowShader.frag", "Shaders/shadowShader.geom");
+	shadowShader = Shader("Shaders/shadowShader.vert", "Shaders/shadowShader.frag");
 	shadowShader.compile();
+	asteroidShadowShader = shadowShader.variant({ "INSTANCED" });
+
+	//edited shader files are recompiled while the application runs (programs swapped between two frames)
+	ShaderReloader shaderReloader;
 
 
 	//Textures
-	skyboxTexture = createCubeMapTexture();
-	jumperReflectionMap = loadTexture("Models/reflectionMapJumper.png");
-	sunTexture = loadTexture("Models/2k_sun.jpg");
-	weirdCubeNormalMapTexture = loadTexture("Models/weirdCubeNormalMap.png");
+	TextureRegistry& textureRegistry = TextureRegistry::instance(); //shared with the models: an image used by both is only loaded once
+	skyboxTexture = skyboxFaces.empty() ? textureRegistry.acquireBaked(cubeMapKey(skyboxFaceList), skyboxBakedPath, skyboxFaceList) : 0;
+	if (!skyboxTexture) {
+		if (skyboxFaces.empty()) //the baked cubemap could not be used after all
+			for (const char* facePath : skyboxFacePaths)
+				skyboxFaces.push_back(loaderPool.submit([facePath]() { return decodeImage(facePath); }));
+		skyboxTexture = createCubeMapTexture(skyboxFaces); //upload of the faces decoded on the worker pool
+	}
+	//2D textures: baked versions are uploaded right away, the others are streamed
+	jumperReflectionMap = textureRegistry.acquire2D(jumperReflectionMapPath, &textureStreamer, glm::vec4(0.0f)); //no reflection until loaded
+	sunTexture = textureRegistry.acquire2D(sunTexturePath, &textureStreamer, glm::vec4(1.0f, 0.8f, 0.4f, 1.0f));
+	weirdCubeNormalMapTexture = textureRegistry.acquire2D(weirdCubeNormalMapPath, &textureStreamer, glm::vec4(0.5f, 0.5f, 1.0f, 1.0f)); //flat normal
 
 	//VAO instanciation
 	AxisVAO = createAxisVAO();
@@ -356,26 +481,15 @@ int main(int argc, char* argv[]) {
 	starsVAO = createStarsVAO(&starsCount);
 	quadVAO = createFramebufferQuadVAO();
 
-	//Models
-	StargateModel = Model("Models/Stargate.obj"); //Stargate
-	waterPlaneStargateModel = Model("Models/waterPlaneStargate.obj");
-
-	JumperModel = Model("Models/Jumper.obj");
+	//Models (uploads of the meshes and textures loaded on the worker pool)
+	for (unsigned int i = 0; i < modelsLoading.size(); i++) {
+		modelsLoading[i].get();
+		modelAssets[i].model->packedVertices = modelAssets[i].packedVertices;
+		modelAssets[i].model->upload(&textureStreamer);
+	}
 	jumper1.setModel(&JumperModel);
-
-	PlanetModel = Model("Models/planet.obj");
-
-	AsteroidModel = Model("Models/rock.obj");
-	createAsteroidVAO(asteroidAmount, AsteroidModel, planetPos); //no return value as there is one VAO per asteroid...
-
-	SunModel = Model("Models/Sun.obj");
-
-	missileModel = Model("Models/missile.obj");
-
-	lightBulbCenterModel = Model("Models/lightBulbCenter.obj");
-	lightBulbGlassModel = Model("Models/lightBulbGlass.obj");
-
-	weirdCubeModel = Model("Models/weirdCube.obj");
+	asteroidRing.center = planetPos; //the ring around the planet
+	createAsteroidVAO(AsteroidModel); //no return value as there is one VAO per asteroid...
 
 
 	//particles
@@ -393,7 +507,7 @@ int main(int argc, char* argv[]) {
 	LightSource jumperFlashLight = LightSource(&lightCounter, SPOTLIGHT, jumper1.Position + flashlightJumperOffset, glm::vec3(0.9f, 0.95f, 0.4f), glm::vec3(0.9f, 0.95f, 0.4f), glm::vec3(0.9f, 0.95f, 0.4f), 1.0f, 0.0032f, 0.0008f, glm::vec3(0.0f,0.0f,1.0f), 8.5f, 12.5f, 0.2f, 0);
 	lightArray.push_back(&jumperFlashLight);
 	
-	//note: sunlight should always at index 4 in the list (used in shadows for ease)
+	//the sunlight casts the shadows, the lit shaders find it in their light list through SceneUniforms::updateLights
 	LightSource sunLight = LightSource(&lightCounter, POINTLIGHT, sunPos, glm::vec3(1.0f, 0.6f, 0.2f)*1.0f, 1.0f, 0.00080f, 0.0000070f, 1.0f, lightVAO);
 	lightArray.push_back(&sunLight);
 
@@ -404,25 +518,18 @@ int main(int argc, char* argv[]) {
 
 	
 	//shadows: configure framebuffer object
-	const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-	unsigned int depthMapFBO;
-	glGenFramebuffers(1, &depthMapFBO);
+	const GLsizei shadowSize = shadowQuality.tier().resolution; //resized by applyShadowQuality when the tier changes
 	//generating depth cubemap
 	glGenTextures(1, &depthCubemap);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 	for (unsigned int i = 0; i < 6; ++i)
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, shadowSize, shadowSize, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-	// attach depth texture as the framebuffer depth buffer
-	glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-	glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthCubemap, 0);
-	glDrawBuffer(GL_NONE); //no color so explicitely sets the color buffer to none
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	shadowCache.create(depthCubemap, shadowSize); //framebuffers rendering the faces one by one
 	
 
 	//framebuffer configuration for second POV
@@ -459,6 +566,22 @@ int main(int argc, char* argv[]) {
 		float currentFrame = glfwGetTime();
 		deltaTime = currentFrame - lastFrame;
 		lastFrame = currentFrame;
+		if (shadowQuality.frameTime(deltaTime)) //adaptive shadow quality, a tier lower or higher
+			applyShadowQuality();
+
+		//textures finishing their upload (a few per frame, the others keep their placeholder)
+		textureStreamer.update();
+
+		//programs whose source files were edited, before anything is drawn with them
+		shaderReloader.update();
+
+		//asteroid ring: the cells near the camera (generated on the loader pool), then the transforms of this frame, written in
+		//the instance buffer of the culling
+		double asteroidTime = glfwGetTime();
+		asteroidStreamer.update(camera.Position, asteroidTime, loaderPool);
+		asteroidCuller.setInstanceCount(asteroidStreamer.residentCount());
+		asteroidStreamer.orbits().update(asteroidTime, asteroidCuller.beginUpdate(), &framePool);
+		asteroidCuller.endUpdate();
 
 		//audio
 		if (musicBool) {
@@ -481,46 +604,70 @@ int main(int argc, char* argv[]) {
 		//4)The first scene is then rendered on a quad set up in the upper right corner in NDC.
 		//5)An additional pass is required to draw the outline of the jumper by using the stencil buffer for the default framebuffer.
 
-		if (shadowBool) {
+		if (shadowBool)
+			stargateAngle -= 0.016f; //the gate also turns in the shadow pass, kept on the frames the cubemap is not updated
+		if (shadowBool && shadowQuality.updateDue(shadowFrame++)) {
 			//point shadow mapping: generate the projection matrix from a light and 6 view matrix for each face of the cubemap
 			//90degree FOV for each face of the cubemap
-			glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT, near_plane, far_plane);
+			glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), 1.0f, near_plane, far_plane);
+			std::vector<glm::mat4> shadowViews;
+			shadowViews.push_back(glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+			shadowViews.push_back(glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+			shadowViews.push_back(glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
+			shadowViews.push_back(glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
+			shadowViews.push_back(glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+			shadowViews.push_back(glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
 			std::vector<glm::mat4> shadowTransforms;
-			shadowTransforms.push_back(shadowProj * glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-			shadowTransforms.push_back(shadowProj * glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(-1.0f, 0.0f, 0.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-			shadowTransforms.push_back(shadowProj * glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)));
-			shadowTransforms.push_back(shadowProj * glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(0.0f, -1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f)));
-			shadowTransforms.push_back(shadowProj * glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
-			shadowTransforms.push_back(shadowProj * glm::lookAt(glm::vec3(sunLight.Position), glm::vec3(sunLight.Position) + glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, -1.0f, 0.0f)));
+			for (const glm::mat4& shadowView : shadowViews)
+				shadowTransforms.push_back(shadowProj * shadowView);
 
 
-			//render the scene to the depth cubemap
+			//render the scene to the depth cubemap, face by face with the casters culled against the frustum of each face
 			glEnable(GL_DEPTH_TEST);
-			glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-			glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-			glClear(GL_DEPTH_BUFFER_BIT);
-			shadowShader.use();
-			for (unsigned int i = 0; i < 6; ++i) {
-				shadowShader.setMatrix4(("shadowMatrices[" + std::to_string(i) + "]").c_str(), shadowTransforms[i]);
+			glViewport(0, 0, shadowCache.size(), shadowCache.size());
+			Shader* shadowPrograms[2] = { &shadowShader, &asteroidShadowShader };
+			for (Shader* program : shadowPrograms) {
+				program->use();
+				program->setFloat("far_plane", far_plane);
+				program->setVector3f("lightPos", sunLight.Position);
+			}
+			shadowCache.setLight(glm::vec3(sunLight.Position), &shadowTransforms[0]);
+			//static casters, drawn in the cache on the faces where one of them changed
+			trackStaticShadowCasters();
+			unsigned int staticFaces = shadowCache.beginStatic();
+			for (unsigned int face = 0; face < 6; face++) {
+				if (staticFaces & (1u << face)) {
+					shadowCache.bindStaticFace(face);
+					setShadowFace(shadowTransforms[face]);
+					drawPlanetShadow(face);
+				}
+			}
+			//moving casters, on top of a copy of the cache in the faces they reach
+			shadowCasters.clear();
+			addMissileShadow();
+			addJumperShadow();
+			addWeirdCubesShadow();
+			addStargateShadow();
+			addLightBulbShadow(rotatingLight.Position);
+			unsigned int asteroidFaces = shadowCache.facesOf(asteroidFieldCenter, asteroidFieldRadius); //the orbiting ring
+			unsigned int casterFaces = asteroidFaces;
+			for (const ShadowCaster& caster : shadowCasters)
+				casterFaces |= caster.faces;
+			unsigned int dynamicFaces = shadowCache.beginDynamic(casterFaces);
+			for (unsigned int face = 0; face < 6; face++) {
+				if (dynamicFaces & (1u << face)) {
+					shadowCache.bindFace(face);
+					setShadowFace(shadowTransforms[face]);
+					drawShadowCasters(face);
+					if (asteroidFaces & (1u << face))
+						drawAsteroidsShadow(shadowProj, shadowViews[face], glm::vec3(sunLight.Position));
+				}
 			}
-			shadowShader.setFloat("far_plane", far_plane);
-			shadowShader.setVector3f("lightPos", sunLight.Position);
-			//render the scene to get the depth cubemap
-			drawPlanetShadow();
-			drawAsteroidsShadow();
-			drawMissileShadow();
-			drawJumperShadow();
-			drawWeirdCubesShadow();
-			drawStargateShadow();
-			drawLightBulbShadow(rotatingLight.Position);
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			shadowCache.endFrame();
 		}
 
-		else { //if no shadows, just clean up the texture (otherwise the last shadows stay rendered)
-			glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-			glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-			glClear(GL_DEPTH_BUFFER_BIT);
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		else if (!shadowBool) { //if no shadows, just clean up the texture (otherwise the last shadows stay rendered)
+			shadowCache.clear();
 		}
 
 
@@ -531,10 +678,12 @@ int main(int argc, char* argv[]) {
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
 		glEnable(GL_DEPTH_TEST);
+		sceneUniforms.updateLights(lightArray, &sunLight); //lights only move between frames, each lit object gets the ones reaching it
 		camera.copyThisCamera(camera2); //set the camera with the attributes of cam2
 		//Calculate coordinate systems every frame
 		viewMatrix = createViewMatrix2();
 		projectionMatrix = createProjectionMatrix();
+		sceneUniforms.updateFrame(viewMatrix, projectionMatrix, camera.Position, far_plane);
 		drawSkybox();
 		//drawAxis();
 		drawStargate();
@@ -561,6 +710,7 @@ int main(int argc, char* argv[]) {
 		//Calculate coordinate systems every frame
 		viewMatrix = createViewMatrix1();
 		projectionMatrix = createProjectionMatrix();
+		sceneUniforms.updateFrame(viewMatrix, projectionMatrix, camera.Position, far_plane);
 		drawSkybox();
 		//drawAxis();
 		drawStargate();
@@ -581,12 +731,7 @@ int main(int argc, char* argv[]) {
 
 		if (followCameraPOV) { //toggles the second pov
 		glStencilFunc(GL_ALWAYS, 1, 0xFF);
-		framebufferShader.use();
-		framebufferShader.setInteger("grayscale", grayscale);
-		framebufferShader.setInteger("kernel", kernel);
-		framebufferShader.setInteger("sharpen", sharpen);
-		framebufferShader.setInteger("blur", blur);
-		framebufferShader.setInteger("edgeDetection", edgeDetection);
+		framebufferShader.variant(postEffectDefines()).use();
 		glBindVertexArray(quadVAO);
 		glDisable(GL_DEPTH_TEST);
 		glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
@@ -656,9 +801,38 @@ GLuint createAxisVAO(void) {
 
 
 //CUBEMAP SKYBOX 
-GLuint createCubeMapTexture(void) {
-	std::vector<std::string> textures = { "CubeMap/posx.png", "CubeMap/negx.png", "CubeMap/posy.png", "CubeMap/negy.png", "CubeMap/posz.png", "CubeMap/negz.png" }; // Must be 6 images
-	GLuint texture;
+//key of a cubemap in the TextureRegistry
+std::string cubeMapKey(const std::vector<std::string>& facePaths) {
+	std::string key = "cubemap:";
+	for (unsigned int i = 0; i < facePaths.size(); i++)
+		key += facePaths[i] + ";";
+	return key;
+}
+
+GLuint createCubeMapTexture(std::vector<std::future<DecodedImage>>& faces) { //faces decoded on the worker pool, in the +X -X +Y -Y +Z -Z order
+	std::vector<DecodedImage> images;
+	for (GLuint i = 0; i < faces.size(); i++)
+		images.push_back(faces[i].get());
+
+	//the cubemap is registered under the list of its faces, and identified by the content of all of them
+	std::vector<std::string> facePaths;
+	std::vector<uint64_t> faceHashes;
+	for (GLuint i = 0; i < images.size(); i++) {
+		facePaths.push_back(images[i].path);
+		faceHashes.push_back(images[i].contentHash);
+	}
+	std::string key = cubeMapKey(facePaths);
+	uint64_t contentHash = hashBytes(faceHashes.data(), faceHashes.size() * sizeof(uint64_t));
+	TextureRegistry& registry = TextureRegistry::instance();
+	GLuint texture = registry.find(key);
+	if (!texture)
+		texture = registry.findContent(contentHash, key);
+	if (texture) {
+		for (GLuint i = 0; i < images.size(); i++)
+			freeImage(images[i]);
+		return texture;
+	}
+
 	glGenTextures(1, &texture);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -666,14 +840,12 @@ GLuint createCubeMapTexture(void) {
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	int width, height, n;
-	unsigned char* image;
-	for (GLuint i = 0; i < textures.size(); i++) {
-		image = stbi_load(textures[i].c_str(), &width, &height, &n, 0);
-		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		stbi_image_free(image);
+	for (GLuint i = 0; i < images.size(); i++) {
+		glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA, images[i].width, images[i].height, 0, GL_RGBA, GL_UNSIGNED_BYTE, images[i].pixels);
+		freeImage(images[i]);
 	}
 	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	registry.add(key, contentHash, texture);
 	return texture;
 }
 
@@ -771,70 +943,23 @@ GLuint createStarsVAO(int* starsCount) {
 	return VAO;
 }
 
-void createAsteroidVAO(int asteroidAmount, Model asteroidModel, glm::vec3 planetPos) {
+void createAsteroidVAO(const Model& asteroidModel) {
 	//Note: largely inspired by learnopengl.com instancing tutorial
-	// generate a large list of semi-random model transformation matrices
-	// ------------------------------------------------------------------
-	unsigned int amount = asteroidAmount;
-	glm::mat4* modelMatrices;
-	modelMatrices = new glm::mat4[amount];
-	srand(glfwGetTime()); // initialize random seed	
-	float radius = 120.0f;
-	float offset = 40.0f;
-	for (unsigned int i = 0; i < amount; i++)
-	{
-		glm::mat4 model = glm::mat4(1.0f);
-		// 1. translation: displace along circle with 'radius' in range [-offset, offset]
-		float angle = (float)i / (float)amount * 360.0f;
-		float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-		float x = sin(angle) * radius + displacement + planetPos.x; //adding the planet pos to center the asteroid field on the planet
-		displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-		float y = displacement * 0.3f + planetPos.y; // keep height of asteroid field smaller compared to width of x and z
-		displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-		float z = cos(angle) * radius + displacement + planetPos.z;
-		model = glm::translate(model, glm::vec3(x, y, z));
-
-		// 2. scale: Scale between 0.05 and 0.25f
-		float scale = (rand() % 20) / 100.0f + 0.05;
-		model = glm::scale(model, glm::vec3(scale));
-
-		// 3. rotation: add random rotation around a (semi)randomly picked rotation axis vector
-		float rotAngle = (rand() % 360);
-		model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
-
-		// 4. now add to list of matrices
-		modelMatrices[i] = model;
-	}
-
-	// configure instanced array
-// -------------------------
-	unsigned int VBO, VAO;
-	glGenBuffers(1, &VBO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, amount * sizeof(glm::mat4), &modelMatrices[0], GL_STATIC_DRAW);
-
-	// set transformation matrices as an instance vertex attribute (with divisor 1)
-	for (unsigned int i = 0; i < asteroidModel.meshes.size(); i++)
-	{
-		VAO = asteroidModel.meshes[i].VAO;
-		glBindVertexArray(VAO);
-		// set attribute pointers for matrix (4 times vec4)
-		glEnableVertexAttribArray(3);
-		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)0);
-		glEnableVertexAttribArray(4);
-		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4)));
-		glEnableVertexAttribArray(5);
-		glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(2 * sizeof(glm::vec4)));
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(3 * sizeof(glm::vec4)));
-
-		glVertexAttribDivisor(3, 1);
-		glVertexAttribDivisor(4, 1);
-		glVertexAttribDivisor(5, 1);
-		glVertexAttribDivisor(6, 1);
-
-		glBindVertexArray(0);
-	}
+	// the ring is generated from its seed, cell by cell as the camera gets close to them
+	// ------------------------------------------------------------
+	//a turn in 3 minutes on the middle of the ring, faster inside, slower outside
+	float reach = glm::length(asteroidModel.boundsCenter) + asteroidModel.boundsRadius;
+	asteroidStreamer.create(asteroidRing, asteroidBudget, 6.2832f / 180.0f, reach);
+
+	//bounds of the field, for the shadow cache: the orbits keep the distance to the planet, the tumble moves the bounding
+	//sphere of an asteroid around its position
+	asteroidFieldCenter = asteroidStreamer.boundsCenter();
+	asteroidFieldRadius = asteroidStreamer.boundsRadius();
+
+	// configure instanced array: the culler fills the instance buffer with the visible asteroids and sets the transforms as
+	// instance vertex attributes (with divisor 1), its buffers are sized for the budget and start empty
+	asteroidCuller.create(asteroidModel.meshes, asteroidModel.boundsCenter, asteroidModel.boundsRadius, asteroidModel.lodErrors, std::vector<InstanceTransform>(),
+		Shader("Shaders/instanceCull.vert", nullptr, "Shaders/instanceCull.geom"), gpuAsteroidCulling, asteroidBudget);
 }
 
 GLuint createFramebufferQuadVAO() {
@@ -863,6 +988,24 @@ GLuint createFramebufferQuadVAO() {
 	return quadVAO;
 }
 
+//post-processing effect of the second POV, the same priority as the flags had in framebuffer.frag
+std::vector<std::string> postEffectDefines() {
+	std::vector<std::string> defines;
+	if (grayscale == 1)
+		defines.push_back("GRAYSCALE");
+	else if (kernel == 1) {
+		if (sharpen == 1)
+			defines.push_back("KERNEL_SHARPEN");
+		else if (blur == 1)
+			defines.push_back("KERNEL_BLUR");
+		else if (edgeDetection == 1)
+			defines.push_back("KERNEL_EDGE_DETECTION");
+		else
+			defines.push_back("KERNEL");
+	}
+	return defines;
+}
+
 //////////////////////////////////////////
 ////        COORDINATE SYSTEMS         ///
 //////////////////////////////////////////
@@ -947,40 +1090,46 @@ void showFPS(void) {
 
 GLuint loadTexture(char const* path)
 {
-	GLuint textureID;
-	glGenTextures(1, &textureID);
+	return TextureRegistry::instance().acquire2D(path);
+}
 
-	int width, height, nrComponents;
-	unsigned char* imageData = stbi_load(path, &width, &height, &nrComponents, 0);
-	if (imageData)
-	{
-		GLenum format{};
-		if (nrComponents == 1)
-			format = GL_RED;
-		else if (nrComponents == 3)
-			format = GL_RGB;
-		else if (nrComponents == 4)
-			format = GL_RGBA;
-
-		glBindTexture(GL_TEXTURE_2D, textureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, imageData);
-		glGenerateMipmap(GL_TEXTURE_2D); // generate the mipmaps
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		stbi_image_free(imageData);
-		cout << "Texture loaded at path: " << path << std::endl;
+//offline texture baking: Glitter --bake-textures [--uncompressed] [image files...]
+//Without files, bakes every texture of the scene: the textures of the models, the standalone ones and the skybox.
+//Normal maps are never block compressed (DXT artifacts show badly in the lighting)
+int bakeTextures(int argc, char* argv[]) {
+	bool compress = true;
+	std::vector<std::string> images;
+	for (int i = 2; i < argc; i++) {
+		if (std::string(argv[i]) == "--uncompressed")
+			compress = false;
+		else
+			images.push_back(argv[i]);
 	}
-	else
-	{
-		cout << "Texture failed to load at path: " << path << std::endl;
-		stbi_image_free(imageData);
+	bool bakeScene = images.empty();
+	if (bakeScene) {
+		for (const ModelAsset& asset : modelAssets) {
+			Model model;
+			model.load(asset.path, false); //CPU only, no GL context needed
+			std::vector<std::string> modelTextures = model.texturePaths();
+			images.insert(images.end(), modelTextures.begin(), modelTextures.end());
+		}
+		images.push_back(jumperReflectionMapPath);
+		images.push_back(sunTexturePath);
+		images.push_back(weirdCubeNormalMapPath);
 	}
-	glBindTexture(GL_TEXTURE_2D, 0); // Unbind texture when done, so we won't accidently mess up our texture.
-	return textureID;
+
+	int failures = 0;
+	for (unsigned int i = 0; i < images.size(); i++) {
+		std::string lowerPath = images[i];
+		for (unsigned int c = 0; c < lowerPath.size(); c++)
+			lowerPath[c] = (char)tolower(lowerPath[c]);
+		bool normalMap = lowerPath.find("normal") != std::string::npos;
+		if (!TextureBaker::bake2D(images[i], compress && !normalMap))
+			failures++;
+	}
+	if (bakeScene && !TextureBaker::bakeCubeMap(std::vector<std::string>(skyboxFacePaths, skyboxFacePaths + 6), skyboxBakedPath, compress))
+		failures++;
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 //////////////////////////////////////////
@@ -1175,6 +1324,26 @@ static void key_callback(GLFWwindow* window, int key, int /*scancode*/, int acti
 		shadowBool = !shadowBool;
 	}
 
+	//Shadow quality: next tier, adaptive mode
+	if (keys[GLFW_KEY_KP_9]) {
+		shadowQuality.selectTier((shadowQuality.selectedTier() + 1) % ShadowQuality::tierCount);
+		cout << "SHADOWS:: " << shadowQuality.tier().name << " shadows" << endl;
+		applyShadowQuality();
+	}
+	if (keys[GLFW_KEY_KP_0]) {
+		shadowQuality.setAdaptive(!shadowQuality.adaptive());
+		cout << "SHADOWS:: adaptive quality " << (shadowQuality.adaptive() ? "on" : "off") << endl;
+		applyShadowQuality();
+	}
+
+	//Lighting: clustered or per object light lists
+	if (keys[GLFW_KEY_C]) {
+		sceneUniforms.setClustered(!clusteredLighting);
+		clusteredLighting = sceneUniforms.clustered();
+		cout << "LIGHTING:: " << (clusteredLighting ? "clustered" : "per object light lists") << endl;
+		selectLitShaders();
+	}
+
 	//Wireframe or point mode 
 	if (keys[GLFW_KEY_1] || keys[GLFW_KEY_KP_1])
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
@@ -1303,47 +1472,62 @@ void drawAxis() {
 	glBindVertexArray(AxisVAO);
 	axisShader.use();
 	axisShader.setMatrix4("model", glm::mat4(1.0f));
-	axisShader.setMatrix4("view", viewMatrix);
-	axisShader.setMatrix4("projection", projectionMatrix);
 	glDrawElements(GL_LINES, 12, GL_UNSIGNED_INT, 0);
 	glBindVertexArray(0);
 }
 
+void bindLightsFor(const Model& model, const glm::mat4& modelMatrix) {
+	glm::vec3 center;
+	float radius;
+	model.worldBounds(modelMatrix, center, radius);
+	sceneUniforms.bindLightsFor(center, radius);
+}
+
+std::vector<std::string> lightingDefines(std::vector<std::string> defines) {
+	if (clusteredLighting)
+		defines.push_back("CLUSTERED_LIGHTING");
+	defines.push_back("SHADOW_SAMPLES " + std::to_string(shadowQuality.tier().samples));
+	return defines;
+}
+
+void selectLitShaders() {
+	stargateShader = modelShaderBase.variant(lightingDefines({ "SUN_SHADOW" }));
+	jumperShader = modelShaderBase.variant(lightingDefines({ "SUN_SHADOW", "REFLECTION", "REFLECTION_MAP" }));
+	missileShader = missileShaderBase.variant(lightingDefines({}));
+	weirdCubeShader = weirdCubeShaderBase.variant(lightingDefines({}));
+	planetShader.variant(lightingDefines({}));
+	planetShader.variant(lightingDefines({ "REFLECTION" })); //variants of the U and I toggles built now rather than on the first key press
+	planetShader.variant(lightingDefines({ "REFRACTION" }));
+}
+
+void applyShadowQuality() {
+	selectLitShaders(); //compiled on the first use of a tier, kept afterwards
+	shadowCache.resize(shadowQuality.tier().resolution);
+}
+
 void drawStargate() {
 	glDisable(GL_CULL_FACE); //needs to be turned off here since Blender model with triangles not specifically in the correct direction
 	stargateShader.use();
 	glActiveTexture(GL_TEXTURE15);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
 	stargateShader.setInteger("skybox", 15);
-	stargateShader.setFloat("material.refractionRatio", 0.0f);
-	stargateShader.setInteger("material.reflection", 0);
-	stargateShader.setInteger("material.reflectionMap", 0);
 	stargateAngle -= 0.016f;
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix = glm::translate(modelMatrix, stargatePos);
 	modelMatrix = glm::rotate(modelMatrix, glm::radians(stargateAngle), glm::vec3(1.0f, 0.0f, 0.0f));
 	stargateShader.setMatrix4("model", modelMatrix);
-	stargateShader.setMatrix4("view", viewMatrix);
-	stargateShader.setMatrix4("projection", projectionMatrix);
-	stargateShader.setVector3f("viewPos", camera.Position);
 	stargateShader.setFloat("material.shininess", 32.0f);
 	stargateShader.setFloat("explosionDistance", -1);
+	bindLightsFor(StargateModel, modelMatrix);
 
-	stargateShader.setInteger("lightCounter", lightCounter); //Sets the number of lights in the environment
 
-	for (int i = 0; i < lightCounter; i++) { //sends the light info to the object shaders
-		(*lightArray[i]).setModelShaderLightParameters(stargateShader, i);
-	}
-	stargateShader.setFloat("far_plane", far_plane);
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 	stargateShader.setInteger("depthMap", 10);
-	StargateModel.Draw(stargateShader);
+	StargateModel.Draw(stargateShader, StargateModel.selectLod(StargateModel.pixelsPerUnit(modelMatrix, camera.Position, projectionMatrix, windowHeight), lodPixelError));
 
 	waterPlaneStargateShader.use();
 	waterPlaneStargateShader.setMatrix4("model", modelMatrix);
-	waterPlaneStargateShader.setMatrix4("view", viewMatrix);
-	waterPlaneStargateShader.setMatrix4("projection", projectionMatrix);
 	waterPlaneStargateShader.setVector3f("stargatePos", stargatePos);
 	waterPlaneStargateShader.setFloat("time", glfwGetTime() / 5);
 	waterPlaneStargateShader.setFloat("aspect", windowWidth/windowHeight);
@@ -1352,24 +1536,19 @@ void drawStargate() {
 	angleStargateFOV = 2 * tan((1.0f) / distanceStargate);
 	waterPlaneStargateShader.setFloat("cameraFov", camera.Fov);
 	waterPlaneStargateShader.setFloat("angle", glm::degrees(angleStargateFOV));
-	waterPlaneStargateShader.setFloat("far_plane", far_plane);
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 	waterPlaneStargateShader.setInteger("depthMap", 10);
 	waterPlaneStargateModel.Draw(waterPlaneStargateShader);
 }
 
-void drawStargateShadow() {
-	glDisable(GL_CULL_FACE); //needs to be turned off here since Blender model with triangles not specifically in the correct direction
-	shadowShader.use();
-	stargateAngle -= 0.016f;
+void addStargateShadow() {
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix = glm::translate(modelMatrix, stargatePos);
 	modelMatrix = glm::rotate(modelMatrix, glm::radians(stargateAngle), glm::vec3(1.0f, 0.0f, 0.0f));
-	shadowShader.setMatrix4("model", modelMatrix);
-	StargateModel.Draw(shadowShader);
-
-	waterPlaneStargateModel.Draw(shadowShader);
+	//no face culling, Blender model with triangles not specifically in the correct direction
+	addShadowCaster(StargateModel, modelMatrix, false, StargateModel.selectLod(StargateModel.pixelsPerUnit(modelMatrix, camera.Position, projectionMatrix, windowHeight), lodPixelError));
+	addShadowCaster(waterPlaneStargateModel, modelMatrix, false);
 }
 
 void drawSun() {
@@ -1380,8 +1559,6 @@ void drawSun() {
 	float scale = 60.0f;
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(scale));
 	sunShader.setMatrix4("model", modelMatrix);
-	sunShader.setMatrix4("view", viewMatrix);
-	sunShader.setMatrix4("projection", projectionMatrix);
 	sunShader.setVector3f("sunPos", sunPos);
 	sunShader.setFloat("aspect", windowWidth/windowHeight);
 	sunShader.setFloat("time", glfwGetTime() / 10); //don't move too fast
@@ -1396,7 +1573,7 @@ void drawSun() {
 
 void drawPlanet() {
 	glEnable(GL_CULL_FACE); //we can use face culling from here to save performance
-	planetShader.use();
+	Shader& shader = planetShader.variant(planetDefines()).use(); //program specialized for the reflection and refraction toggles
 	modelMatrix = glm::mat4(1.0f);
 	planetRotation += 0.12f;
 	if (planetRotation >= 360.0f) {
@@ -1405,74 +1582,128 @@ void drawPlanet() {
 	modelMatrix = glm::rotate(modelMatrix, glm::radians(planetRotation), glm::vec3(0.1f, 1.0f, 0.2f));
 	modelMatrix[3] = glm::vec4(planetPos, 1.0f);
 	modelMatrix = glm::scale(modelMatrix, glm::vec3(8.0f, 8.0f, 8.0f));
-	planetShader.setMatrix4("model", modelMatrix);
-	planetShader.setMatrix4("view", viewMatrix);
-	planetShader.setMatrix4("projection", projectionMatrix);
-	planetShader.setVector3f("viewPos", camera.Position);
-	planetShader.setFloat("material.shininess", 16.0f);
+	shader.setMatrix4("model", modelMatrix);
+	shader.setFloat("material.shininess", 16.0f);
+	bindLightsFor(PlanetModel, modelMatrix);
 	glActiveTexture(GL_TEXTURE15);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, skyboxTexture);
-	planetShader.setInteger("skybox", 15);
-	planetShader.setFloat("material.refractionRatio", planetRefractionRatio);
-	planetShader.setInteger("material.reflection", planetReflection);
-	planetShader.setInteger("lightCounter", lightCounter); //Sets the number of lights in the environment
-	for (int i = 0; i < lightCounter; i++) { //sends the light info to the object shaders
-		(*lightArray[i]).setModelShaderLightParameters(planetShader, i);
-	}
-	planetShader.setFloat("far_plane", far_plane);
+	shader.setInteger("skybox", 15);
+	shader.setFloat("material.refractionRatio", planetRefractionRatio);
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
-	planetShader.setInteger("depthMap", 10);
-	PlanetModel.Draw(planetShader);
+	shader.setInteger("depthMap", 10);
+	PlanetModel.Draw(shader, PlanetModel.selectLod(PlanetModel.pixelsPerUnit(modelMatrix, camera.Position, projectionMatrix, windowHeight), lodPixelError));
 }
 
-void drawPlanetShadow() {
+//environment mapping of the planet (U and I keys)
+std::vector<std::string> planetDefines() {
+	std::vector<std::string> defines;
+	if (planetReflection == 1)
+		defines.push_back("REFLECTION");
+	if (planetRefractionRatio != 0.0f)
+		defines.push_back("REFRACTION");
+	return lightingDefines(defines);
+}
+
+void drawPlanetShadow(unsigned int face) {
+	glm::mat4 planetMatrix = planetShadowMatrix();
+	glm::vec3 center;
+	float radius;
+	PlanetModel.worldBounds(planetMatrix, center, radius);
+	if ((shadowCache.facesOf(center, radius) & (1u << face)) == 0)
+		return;
 	glEnable(GL_CULL_FACE); //we can use face culling from here to save performance
 	shadowShader.use();
+	shadowShader.setMatrix4("model", planetMatrix);
+	PlanetModel.Draw(shadowShader, planetShadowLod());
+}
+
+//without the spin of the planet, which does not change the shadow of a sphere, so that it stays in the shadow cache
+glm::mat4 planetShadowMatrix() {
 	modelMatrix = glm::mat4(1.0f);
-	if (planetRotation >= 360.0f) {
-		planetRotation = 0.0f;
-	}
-	modelMatrix = glm::rotate(modelMatrix, glm::radians(planetRotation), glm::vec3(0.1f, 1.0f, 0.2f));
 	modelMatrix[3] = glm::vec4(planetPos, 1.0f);
-	modelMatrix = glm::scale(modelMatrix, glm::vec3(8.0f, 8.0f, 8.0f));
-	shadowShader.setMatrix4("model", modelMatrix);
+	return glm::scale(modelMatrix, glm::vec3(8.0f, 8.0f, 8.0f));
+}
 
-	PlanetModel.Draw(shadowShader);
+//same level as the camera pass, so that the shadow matches the surface it falls on
+unsigned int planetShadowLod() {
+	return PlanetModel.selectLod(PlanetModel.pixelsPerUnit(planetShadowMatrix(), camera.Position, projectionMatrix, windowHeight), lodPixelError);
+}
+
+void trackStaticShadowCasters() {
+	glm::vec3 center;
+	float radius;
+	PlanetModel.worldBounds(planetShadowMatrix(), center, radius);
+	shadowCache.trackStatic(PLANET_SHADOW, center, radius, planetShadowLod()); //a new level changes the shadow
+}
+
+//light space transform of the face of the shadow cubemap about to be rendered: each face is a separate render target
+//drawn on its own, with only the casters whose bounds reach it
+void setShadowFace(const glm::mat4& shadowMatrix) {
+	shadowShader.use();
+	shadowShader.setMatrix4("shadowMatrix", shadowMatrix);
+	asteroidShadowShader.use();
+	asteroidShadowShader.setMatrix4("shadowMatrix", shadowMatrix);
+}
+
+void addShadowCaster(Model& model, const glm::mat4& modelMatrix, bool cullFaces, unsigned int lod) {
+	ShadowCaster caster = { &model, modelMatrix, lod, cullFaces, 0 };
+	glm::vec3 center;
+	float radius;
+	model.worldBounds(modelMatrix, center, radius);
+	caster.faces = shadowCache.facesOf(center, radius);
+	if (caster.faces != 0)
+		shadowCasters.push_back(caster);
+}
+
+void drawShadowCasters(unsigned int face) {
+	shadowShader.use();
+	for (const ShadowCaster& caster : shadowCasters) {
+		if ((caster.faces & (1u << face)) == 0)
+			continue;
+		if (caster.cullFaces)
+			glEnable(GL_CULL_FACE);
+		else
+			glDisable(GL_CULL_FACE);
+		shadowShader.setMatrix4("model", caster.modelMatrix);
+		caster.model->Draw(shadowShader, caster.lod);
+	}
 }
 
 void drawAsteroids() {
+	//asteroids outside the view frustum culled, the others get their level of detail from their size on screen and are grouped
+	//by level so that each level is one instanced draw of a contiguous part of the instance buffer
+	asteroidCuller.cull(projectionMatrix, viewMatrix, camera.Position, windowHeight, lodPixelError);
+
 	glEnable(GL_CULL_FACE); //we can use face culling from here to save performance
 	asteroidShader.use();
-	asteroidShader.setMatrix4("view", viewMatrix);
-	asteroidShader.setMatrix4("projection", projectionMatrix);
 	asteroidShader.setInteger("texture_diffuse1", 0);
 	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, AsteroidModel.textures_loaded[0].id);
 	for (unsigned int i = 0; i < AsteroidModel.meshes.size(); i++)
 	{
-		glBindVertexArray(AsteroidModel.meshes[i].VAO);
-		glDrawElementsInstanced(GL_TRIANGLES, AsteroidModel.meshes[i].indices.size(), GL_UNSIGNED_INT, 0, asteroidAmount);
-		glBindVertexArray(0);
+		AsteroidModel.meshes[i].setVertexFormat(asteroidShader);
+		asteroidCuller.draw(AsteroidModel.meshes[i], i);
 	}
 }
 
-void drawAsteroidsShadow() {
+void drawAsteroidsShadow(const glm::mat4& shadowProj, const glm::mat4& faceView, const glm::vec3& lightPos) {
+	//only the asteroids in the frustum of the face, at the level of detail of their size in the shadow map (the camera cull
+	//of drawAsteroids refills the culled instances afterwards)
+	asteroidCuller.cull(shadowProj, faceView, lightPos, (float)shadowCache.size(), lodPixelError);
+
 	glEnable(GL_CULL_FACE); //we can use face culling from here to save performance
-	shadowShader.use();
+	asteroidShadowShader.use();
 	for (unsigned int i = 0; i < AsteroidModel.meshes.size(); i++)
 	{
-		glBindVertexArray(AsteroidModel.meshes[i].VAO);
-		glDrawElementsInstanced(GL_TRIANGLES, AsteroidModel.meshes[i].indices.size(), GL_UNSIGNED_INT, 0, asteroidAmount);
-		glBindVertexArray(0);
+		AsteroidModel.meshes[i].setVertexFormat(asteroidShadowShader);
+		asteroidCuller.draw(AsteroidModel.meshes[i], i);
 	}
 }
 
 void drawParticles() {
 	Particles->Update(dt, missilePosition, missileDirection, 8, -missileDirection * 4.8f); //rendered on missile position, with an offset to put it at the end, and velocity and its direction
 	particleShader.use();
-	particleShader.setMatrix4("view", viewMatrix);
-	particleShader.setMatrix4("projection", projectionMatrix);
 	Particles->Draw();
 }
 
@@ -1481,15 +1712,10 @@ void drawMissile() {
 	glStencilFunc(GL_ALWAYS, 1, 0xFF); // all fragments from this model should update the stencil buffer
 	glStencilMask(0xFF); // enable writing to the stencil buffer
 	missileShader.use();
-	missileShader.setMatrix4("view", viewMatrix);
-	missileShader.setMatrix4("projection", projectionMatrix);
-	missileShader.setMatrix4("model", createModelMissile(jumper1));
-	missileShader.setVector3f("viewPos", camera.Position);
+	modelMatrix = createModelMissile(jumper1);
+	missileShader.setMatrix4("model", modelMatrix);
 	missileShader.setFloat("material.shininess", 16.0f);
-	missileShader.setInteger("lightCounter", lightCounter); //Sets the number of lights in the environment
-	for (int i = 0; i < lightCounter; i++) { //sends the light info to the object shaders
-		(*lightArray[i]).setModelShaderLightParameters(planetShader, i);
-	}
+	bindLightsFor(missileModel, modelMatrix);
 
 	if (boolCaptureMissileSettings) { //need to store jumper direction and orientation for the missile to follow its path
 		//so i use a flag triggered by glfw keys
@@ -1500,37 +1726,25 @@ void drawMissile() {
 		//after set time, missile is reset
 		missileLaunched = false;
 	}
-	missileShader.setFloat("far_plane", far_plane);
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 	missileShader.setInteger("depthMap", 10);
 	missileModel.Draw(missileShader);
 }
 
-void drawMissileShadow() {
-	glDisable(GL_CULL_FACE); //needs to be turned off here since Blender model with triangles not specifically in the correct direction
-	shadowShader.use();
-	shadowShader.setMatrix4("model", createModelMissile(jumper1));
-	missileModel.Draw(shadowShader);
+void addMissileShadow() {
+	addShadowCaster(missileModel, createModelMissile(jumper1), false); //Blender model with triangles not specifically in the correct direction
 }
 
 void drawWeirdCubes() {
 	glEnable(GL_CULL_FACE); //needs to be turned off here since Blender model with triangles not specifically in the correct direction
 	weirdCubeShader.use();
-	weirdCubeShader.setMatrix4("view", viewMatrix);
-	weirdCubeShader.setMatrix4("projection", projectionMatrix);
-	weirdCubeShader.setVector3f("viewPos", camera.Position);
 	glActiveTexture(GL_TEXTURE12);
 	glBindTexture(GL_TEXTURE_2D, weirdCubeNormalMapTexture);
 	weirdCubeShader.setInteger("normalMap", 12);
 	weirdCubeShader.setFloat("material.shininess", 16.0f);
 	weirdCubeShader.setInteger("normalMapping", weirdCubeNormalMapping);
-	weirdCubeShader.setInteger("lightCounter", lightCounter); //Sets the number of lights in the environment
-	for (int i = 0; i < lightCounter; i++) { //sends the light info to the object shaders
-		(*lightArray[i]).setModelShaderLightParameters(planetShader, i);
-	}
 	glActiveTexture(GL_TEXTURE0);
-	weirdCubeShader.setFloat("far_plane", far_plane);
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 	weirdCubeShader.setInteger("depthMap", 10);
@@ -1542,6 +1756,7 @@ void drawWeirdCubes() {
 		modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, cos((glfwGetTime() * 0.1f) - glm::radians(60.0 * i)) * 20.0f, sin((glfwGetTime() * 0.1f) - glm::radians(60.0 * i)) * 20.0f) + stargatePos);
 		modelMatrix = glm::rotate(modelMatrix, glm::radians(weirdCubeAngle), glm::vec3(1.0f, 0.0f, 0.0f));
 		weirdCubeShader.setMatrix4("model", modelMatrix);
+		bindLightsFor(weirdCubeModel, modelMatrix);
 		weirdCubeModel.Draw(weirdCubeShader);
 	}
 
@@ -1551,6 +1766,7 @@ void drawWeirdCubes() {
 		modelMatrix = glm::translate(modelMatrix, glm::vec3(cos((glfwGetTime() * 0.1f) - glm::radians(36.0 * i)) * 60.0f, 0.0f , sin((glfwGetTime() * 0.1f) - glm::radians(36.0 * i)) * 60.0f) + planetPos);
 		modelMatrix = glm::rotate(modelMatrix, glm::radians(weirdCubeAngle), glm::vec3(1.0f, 0.0f, 0.0f));
 		weirdCubeShader.setMatrix4("model", modelMatrix);
+		bindLightsFor(weirdCubeModel, modelMatrix);
 		weirdCubeModel.Draw(weirdCubeShader);
 	}
 
@@ -1559,18 +1775,16 @@ void drawWeirdCubes() {
 	modelMatrix[3] = glm::vec4(10.0f, 5.0f, 0.0f, 1.0f);
 	modelMatrix = glm::rotate(modelMatrix, glm::radians(weirdCubeAngle), glm::vec3(1.0f, 0.0f, 0.0f));
 	weirdCubeShader.setMatrix4("model", modelMatrix);
+	bindLightsFor(weirdCubeModel, modelMatrix);
 	weirdCubeModel.Draw(weirdCubeShader);
 }
 
-void drawWeirdCubesShadow() {
-	glEnable(GL_CULL_FACE); //needs to be turned off here since Blender model with triangles not specifically in the correct direction
-	shadowShader.use();
+void addWeirdCubesShadow() {
 	for (int i = 0; i < 6; i++) {
 		modelMatrix = glm::mat4(1.0f);
 		modelMatrix = glm::translate(modelMatrix, glm::vec3(0.0f, cos((glfwGetTime() * 0.1f) - glm::radians(60.0 * i)) * 20.0f, sin((glfwGetTime() * 0.1f) - glm::radians(60.0 * i)) * 20.0f) + stargatePos);
 		modelMatrix = glm::rotate(modelMatrix, glm::radians(weirdCubeAngle), glm::vec3(1.0f, 0.0f, 0.0f));
-		shadowShader.setMatrix4("model", modelMatrix);
-		weirdCubeModel.Draw(shadowShader);
+		addShadowCaster(weirdCubeModel, modelMatrix, true);
 	}
 
 	//10 cubes in rotation around the planet
@@ -1578,16 +1792,14 @@ void drawWeirdCubesShadow() {
 		modelMatrix = glm::mat4(1.0f);
 		modelMatrix = glm::translate(modelMatrix, glm::vec3(cos((glfwGetTime() * 0.1f) - glm::radians(36.0 * i)) * 60.0f, 0.0f, sin((glfwGetTime() * 0.1f) - glm::radians(36.0 * i)) * 60.0f) + planetPos);
 		modelMatrix = glm::rotate(modelMatrix, glm::radians(weirdCubeAngle), glm::vec3(1.0f, 0.0f, 0.0f));
-		shadowShader.setMatrix4("model", modelMatrix);
-		weirdCubeModel.Draw(shadowShader);
+		addShadowCaster(weirdCubeModel, modelMatrix, true);
 	}
 
 	//static one
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix[3] = glm::vec4(10.0f, 5.0f, 0.0f, 1.0f);
 	modelMatrix = glm::rotate(modelMatrix, glm::radians(weirdCubeAngle), glm::vec3(1.0f, 0.0f, 0.0f));
-	shadowShader.setMatrix4("model", modelMatrix);
-	weirdCubeModel.Draw(shadowShader);
+	addShadowCaster(weirdCubeModel, modelMatrix, true);
 }
 
 void drawJumper() {
@@ -1611,31 +1823,19 @@ void drawJumper() {
 	else {
 		jumperShader.setFloat("explosionDistance", -1);
 	}
-	jumperShader.setFloat("material.refractionRatio", 0.0f);
-	jumperShader.setInteger("material.reflectionMap", 1);
-	jumperShader.setInteger("material.reflection", 1);
-	jumperShader.setMatrix4("model", moveModel(jumper1, false));
-	jumperShader.setMatrix4("view", viewMatrix);
-	jumperShader.setMatrix4("projection", projectionMatrix);
-	jumperShader.setVector3f("viewPos", camera.Position);
+	modelMatrix = moveModel(jumper1, false);
+	jumperShader.setMatrix4("model", modelMatrix);
 	jumperShader.setFloat("material.shininess", 32.0f);
+	bindLightsFor(JumperModel, modelMatrix);
 
-	jumperShader.setInteger("lightCounter", lightCounter); //Sets the number of lights in the environment
-	for (int i = 0; i < lightCounter; i++) { //sends the light info to the object shaders
-		(*lightArray[i]).setModelShaderLightParameters(jumperShader, i);
-	}
-	jumperShader.setFloat("far_plane", far_plane);
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 	jumperShader.setInteger("depthMap", 10);
 	JumperModel.Draw(jumperShader);
 }
 
-void drawJumperShadow() {
-	glDisable(GL_CULL_FACE); //needs to be turned off here since Blender model with triangles not specifically in the correct direction
-	shadowShader.use();
-	shadowShader.setMatrix4("model", moveModel(jumper1, false));
-	JumperModel.Draw(shadowShader);
+void addJumperShadow() {
+	addShadowCaster(JumperModel, moveModel(jumper1, false), false); //Blender model with triangles not specifically in the correct direction
 }
 
 void drawStars() {
@@ -1643,8 +1843,6 @@ void drawStars() {
 	glBindVertexArray(starsVAO);
 	starsShader.use();
 	starsShader.setMatrix4("model", glm::mat4(1.0f));
-	starsShader.setMatrix4("view", viewMatrix);
-	starsShader.setMatrix4("projection", projectionMatrix);
 	glDrawArraysInstanced(GL_POINTS, 0, 1, starsCount); //uses instance drawing for the stars
 	glBindVertexArray(0);
 }
@@ -1653,12 +1851,9 @@ void drawLightBulb(glm::vec4 position) {
 	//draw light bulb center
 	glEnable(GL_CULL_FACE);
 	lightBulbCenterShader.use();
-	lightBulbCenterShader.setMatrix4("view", viewMatrix);
-	lightBulbCenterShader.setMatrix4("projection", projectionMatrix);
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix[3] = glm::vec4(position);
 	lightBulbCenterShader.setMatrix4("model", modelMatrix);
-	lightBulbCenterShader.setFloat("far_plane", far_plane);
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 	lightBulbCenterShader.setInteger("depthMap", 10);
@@ -1667,29 +1862,18 @@ void drawLightBulb(glm::vec4 position) {
 	//draw light Bulb Glass (blending)
 	glEnable(GL_CULL_FACE); //needs to be turned ON here otherwise the blending will mess up with the texture on the other side of the glass.
 	lightBulbGlassShader.use();
-	lightBulbGlassShader.setMatrix4("view", viewMatrix);
-	lightBulbGlassShader.setMatrix4("projection", projectionMatrix);
 	lightBulbGlassShader.setMatrix4("model", modelMatrix);
-	lightBulbGlassShader.setFloat("far_plane", far_plane);
 	glActiveTexture(GL_TEXTURE10);
 	glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
 	lightBulbGlassShader.setInteger("depthMap", 10);
 	lightBulbGlassModel.Draw(lightBulbGlassShader);
 }
 
-void drawLightBulbShadow(glm::vec4 position) {
-	//draw light bulb center
-	glEnable(GL_CULL_FACE);
-	shadowShader.use();
+void addLightBulbShadow(glm::vec4 position) {
 	modelMatrix = glm::mat4(1.0f);
 	modelMatrix[3] = glm::vec4(position);
-	shadowShader.setMatrix4("model", modelMatrix);
-	lightBulbCenterModel.Draw(shadowShader);
-
-	//draw light Bulb Glass (blending)
-	glEnable(GL_CULL_FACE); //needs to be turned ON here otherwise the blending will mess up with the texture on the other side of the glass.
-	shadowShader.use();
-	lightBulbGlassModel.Draw(shadowShader);
+	addShadowCaster(lightBulbCenterModel, modelMatrix, true);
+	addShadowCaster(lightBulbGlassModel, modelMatrix, true);
 }
 
 
@@ -1699,8 +1883,6 @@ void drawJumperOutlining() {
 	glDisable(GL_DEPTH_TEST); //outline is always drawn above everything
 	modelOutliningShader.use();
 	modelOutliningShader.setMatrix4("model", moveModel(jumper1, true));
-	modelOutliningShader.setMatrix4("view", viewMatrix);
-	modelOutliningShader.setMatrix4("projection", projectionMatrix);
 	JumperModel.Draw(modelOutliningShader);
 	glStencilMask(0xFF);
 	glEnable(GL_DEPTH_TEST);
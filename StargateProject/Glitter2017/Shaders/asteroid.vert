@@ -1,15 +1,22 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos; //w is 1 with the float format
 layout (location = 2) in vec2 aTexCoords;
-layout (location = 3) in mat4 aInstanceMatrix;
+layout (location = 3) in vec4 aInstancePositionScale; //see common/instanceTransform.glsl
+layout (location = 4) in vec4 aInstanceRotation;
 
 out vec2 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "common/frameData.glsl"
+#include "common/vertexFormat.glsl"
+#include "common/instanceTransform.glsl"
+
+vec3 vertexPosition()
+{
+	return decodePosition(aPos);
+}
 
 void main()
 {
     TexCoords = aTexCoords;
-    gl_Position = projection * view * aInstanceMatrix * vec4(aPos, 1.0f); 
+    gl_Position = projection * view * vec4(instanceTransform(vertexPosition(), aInstancePositionScale, aInstanceRotation), 1.0f); 
 }
\ No newline at end of file
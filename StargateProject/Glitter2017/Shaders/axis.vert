@@ -6,8 +6,7 @@ layout(location=1) in vec3 colorIn;
 out vec3 colorOut;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/frameData.glsl"
 
 void main(){
 gl_Position = projection * view * model * vec4(position.x, position.y, position.z, 1.0f);
@@ -0,0 +1,7 @@
+//per view constants shared by all the programs (see SceneUniforms)
+layout (std140) uniform FrameData {
+	mat4 view;
+	mat4 projection;
+	vec3 viewPos;
+	float far_plane;
+};
\ No newline at end of file
@@ -0,0 +1,10 @@
+//compact instance transform (see InstanceTransform): translation and uniform scale, then a unit quaternion (x, y, z, w)
+vec3 rotateByQuaternion(vec3 v, vec4 q)
+{
+	return v + 2.0 * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+
+vec3 instanceTransform(vec3 position, vec4 positionScale, vec4 rotation)
+{
+	return positionScale.xyz + positionScale.w * rotateByQuaternion(position, rotation);
+}
\ No newline at end of file
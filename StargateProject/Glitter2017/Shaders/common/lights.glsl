@@ -0,0 +1,147 @@
+//light list shared by all the lit programs (see SceneUniforms) and the Blinn-Phong terms of a light
+#include "frameData.glsl"
+
+struct Light { //members ordered for a packed std140 layout (96 bytes, see LightBlockEntry)
+    vec4 position;
+    vec3 ambient;
+	int spotlight; //case of spotlight
+    vec3 diffuse;
+	int attenuationBool; //light attenuation for point lights and spotlights using quadratic reduction
+    vec3 specular;
+    float innerCutOff;
+	vec3 direction;
+	float outerCutOff;
+	float constant; 
+    float linear;
+    float quadratic;
+};
+
+//lights reaching a fragment, walked with lightIndex and getLight:
+//for (int i = 0; i < list.count; i++) { int index = lightIndex(list, i); Light l = getLight(index); ... }
+struct LightList {
+	int first;
+	int count;
+	int sun; //index of the sunlight, the only light casting shadows, -1 if there is none
+};
+
+#ifdef CLUSTERED_LIGHTING
+//every light of the scene, binned in view space clusters (see LightClusters): the fragments only walk their cluster's list
+uniform samplerBuffer lightTexels; //6 texels per light, laid out as LightBlockEntry
+uniform usamplerBuffer clusterRanges; //offset and length of the list of each cluster
+uniform usamplerBuffer clusterLightIndices; //lists of the clusters, one after the other
+
+layout (std140) uniform ClusterData {
+	ivec4 clusterGrid; //tiles x, tiles y, depth slices, index of the sunlight
+	vec4 clusterDepth; //near plane, far plane, slice scale, slice bias (slice = log(depth) * scale + bias)
+};
+
+LightList lightList(vec3 fragPos){
+	vec4 viewSpace = view * vec4(fragPos, 1.0f);
+	vec4 clip = projection * viewSpace;
+	vec2 tile = clamp((clip.xy / clip.w) * 0.5f + 0.5f, 0.0f, 1.0f) * vec2(clusterGrid.xy);
+	int slice = int(floor(log(max(-viewSpace.z, clusterDepth.x)) * clusterDepth.z + clusterDepth.w));
+	ivec3 cluster = clamp(ivec3(ivec2(tile), slice), ivec3(0), clusterGrid.xyz - 1);
+	uvec2 range = texelFetch(clusterRanges, cluster.x + clusterGrid.x * (cluster.y + clusterGrid.y * cluster.z)).xy;
+
+	LightList list;
+	list.first = int(range.x);
+	list.count = int(range.y);
+	list.sun = clusterGrid.w;
+	return list;
+}
+
+int lightIndex(LightList list, int i){
+	return int(texelFetch(clusterLightIndices, list.first + i).r);
+}
+
+Light getLight(int index){
+	int texel = index * 6;
+	vec4 t0 = texelFetch(lightTexels, texel);
+	vec4 t1 = texelFetch(lightTexels, texel + 1);
+	vec4 t2 = texelFetch(lightTexels, texel + 2);
+	vec4 t3 = texelFetch(lightTexels, texel + 3);
+	vec4 t4 = texelFetch(lightTexels, texel + 4);
+	vec4 t5 = texelFetch(lightTexels, texel + 5);
+	Light light;
+	light.position = t0;
+	light.ambient = t1.xyz;
+	light.spotlight = floatBitsToInt(t1.w);
+	light.diffuse = t2.xyz;
+	light.attenuationBool = floatBitsToInt(t2.w);
+	light.specular = t3.xyz;
+	light.innerCutOff = t3.w;
+	light.direction = t4.xyz;
+	light.outerCutOff = t4.w;
+	light.constant = t5.x;
+	light.linear = t5.y;
+	light.quadratic = t5.z;
+	return light;
+}
+#else
+#define NR_POINT_LIGHTS 10 //for optimization purposes, only the 10 lights reaching the object the most are given (see LightCulling)
+
+layout (std140) uniform LightData {
+	Light light[NR_POINT_LIGHTS];
+	int lightCounter;
+	int sunLight; //index of the sunlight, the only light casting shadows, -1 if it does not reach the object
+};
+
+LightList lightList(vec3 fragPos){
+	LightList list;
+	list.first = 0;
+	list.count = min(NR_POINT_LIGHTS, lightCounter);
+	list.sun = sunLight;
+	return list;
+}
+
+int lightIndex(LightList list, int i){
+	return i;
+}
+
+Light getLight(int index){
+	return light[index];
+}
+#endif
+
+//weights of a light on a fragment, the spotlight cone and the attenuation are included in all of them
+struct LightTerms {
+	float ambient;
+	float diffuse; //Lambert
+	float specular; //Blinn-Phong
+};
+
+LightTerms calcLightTerms(Light light, vec3 norm, vec3 fragPos, vec3 viewDir, float shininess){
+	//attenuation
+	float attenuation = 1; //default value
+	if(light.attenuationBool == 1){
+		float distance = length(light.position.xyz - fragPos);
+		attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+	}
+
+	// diffuse 
+	vec3 lightDir = vec3(0.0f,0.0f,0.0f); //default value
+	if(light.position.w == 1.0f){ //if light is a point light
+		lightDir = normalize(light.position.xyz - fragPos);
+	}
+	else if(light.position.w == 0.0f){ //if light is directional (no impact from translations)
+		lightDir = normalize(-light.position.xyz);
+	}
+	float diff = max(dot(norm, lightDir), 0.0);
+
+	// specular
+	vec3 halfwayDir = normalize(lightDir + viewDir); //used for Blinn-Phong's shading algorithm to overcome issues with high shininess
+	float spec = pow(max(dot(norm, halfwayDir), 0.0), shininess); 
+
+	//case of a spotlight
+	float intensity = 1.0f;
+	if(light.spotlight == 1){ 
+		float theta = dot(lightDir, normalize(-light.direction)); //cosine of angle between fragment and spot direction
+		intensity = smoothstep(light.outerCutOff, light.innerCutOff, theta);//progressive dark when out of inner cutoff angle cosine
+	}
+
+	LightTerms terms;
+	terms.ambient = intensity * attenuation; //ambient dimmed too so that inside is always lighter than outside spotlight cone
+	terms.diffuse = diff * intensity * attenuation;
+	terms.specular = spec * intensity * attenuation;
+	return terms;
+}
\ No newline at end of file
@@ -0,0 +1,52 @@
+//omnidirectional shadows of the sunlight, PCF over the depth cubemap rendered by the shadow pass
+#include "frameData.glsl"
+#include "lights.glsl"
+
+#ifndef SHADOW_DISK_DIVISOR
+#define SHADOW_DISK_DIVISOR 3.0 //larger values sample closer to the fragment (sharper shadows)
+#endif
+
+#ifndef SHADOW_SAMPLES
+#define SHADOW_SAMPLES 20 //PCF taps, set by the shadow quality tier: 4, 8 or 20 (prefixes of gridSamplingDisk)
+#endif
+
+uniform samplerCube depthMap;
+// array of offset direction for sampling, ordered so that the first 4 (tetrahedron) and 8 (cube corners) are spread evenly
+const vec3 gridSamplingDisk[20] = vec3[]
+(
+   vec3(1, 1,  1), vec3( 1, -1, -1), vec3(-1, 1, -1), vec3(-1, -1, 1), 
+   vec3(1, 1, -1), vec3( 1, -1,  1), vec3(-1, 1,  1), vec3(-1, -1, -1),
+   vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
+   vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
+   vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
+);
+
+//equals 0 when frag not in shadow and 1 when in shadows, with soft shadows from PCF algo
+float shadowCalculation(vec3 fragPos, vec3 lightPos, vec3 viewPos)
+{    
+	vec3 fragToLight = fragPos - lightPos;
+    float currentDepth = length(fragToLight);
+    float shadow = 0.0;
+    float bias = 4.0;
+    int samples = SHADOW_SAMPLES;
+    float viewDistance = length(viewPos - fragPos);
+    float diskRadius = (1.0 + (viewDistance / far_plane)) / SHADOW_DISK_DIVISOR;
+    for(int i = 0; i < samples; ++i)
+    {
+        float closestDepth = texture(depthMap, fragToLight + gridSamplingDisk[i] * diskRadius).r;
+        closestDepth *= far_plane; 
+        if(currentDepth - bias > closestDepth)
+            shadow += 1.0;
+    }
+    shadow /= float(samples);
+        
+    return shadow;
+}
+
+//shadow of a light of the list on a fragment, only the sunlight casts shadows
+float calcSunShadow(vec3 fragPos, LightList list, int index, Light source)
+{
+	if(index == list.sun)
+		return shadowCalculation(fragPos, vec3(source.position), viewPos);
+	return 0.0f;
+}
\ No newline at end of file
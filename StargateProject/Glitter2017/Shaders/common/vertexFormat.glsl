@@ -0,0 +1,23 @@
+//decoding of the quantized vertex format (see PackedVertex), the float format is passed through
+uniform bool packedVertices;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+//octahedral decoding of the packed normals
+vec3 octDecode(vec2 e)
+{
+	vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	if (v.z < 0.0)
+		v.xy = (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(v);
+}
+
+vec3 decodePosition(vec4 position)
+{
+	return packedVertices ? position.xyz * positionScale + positionOffset : position.xyz;
+}
+
+vec3 decodeNormal(vec3 normal)
+{
+	return packedVertices ? octDecode(normal.xy) : normal;
+}
\ No newline at end of file
@@ -1,18 +1,19 @@
 #version 330 core
+//post effect of the second POV, defined by Shader::variant: GRAYSCALE, or a 3x3 kernel with KERNEL_SHARPEN, KERNEL_BLUR,
+//KERNEL_EDGE_DETECTION or KERNEL (box kernel); none of them draws the POV as is
 out vec4 FragColor;
   
 in vec2 TexCoords;
 in vec2 pos2D;
 
 uniform sampler2D screenTexture;
-uniform int grayscale;
-uniform int kernel;
-uniform int sharpen;
-uniform int blur;
-uniform int edgeDetection;
 
 const float offset = 1.0 / 300.0;  
 
+#if !defined(KERNEL) && (defined(KERNEL_SHARPEN) || defined(KERNEL_BLUR) || defined(KERNEL_EDGE_DETECTION))
+#define KERNEL
+#endif
+
 void main()
 {	
 	//dark blue border
@@ -21,13 +22,12 @@ void main()
 	}
 	//POV in the upper right corner
 	else{
-		if(grayscale == 1){
+#if defined(GRAYSCALE)
 		//realistic grayscale using human eye sensibility to green
 		    FragColor = texture(screenTexture, TexCoords);
 			float average = 0.2126 * FragColor.r + 0.7152 * FragColor.g + 0.0722 * FragColor.b;
 			FragColor = vec4(average, average, average, 1.0);
-		}
-		else if(kernel == 1){
+#elif defined(KERNEL)
 		//use of kernels for post-proc effects
 			vec2 offsets[9] = vec2[](
 			vec2(-offset,  offset), // top-left
@@ -41,35 +41,31 @@ void main()
 			vec2( offset, -offset)  // bottom-right    
 			);
 
-			float kernel[9] = float[]( //default kernel
-				1, 1, 1,
-				1, 1, 1,
-				1, 1, 1
-			);
-
-			if(sharpen == 1){
-			kernel = float[](
+#if defined(KERNEL_SHARPEN)
+			const float kernel[9] = float[](
 				-1, -1, -1,
 				-1,  9, -1,
 				-1, -1, -1
 			);
-			  }
-
-			else if(blur == 1){
-				kernel = float[](
+#elif defined(KERNEL_BLUR)
+			const float kernel[9] = float[](
 				1.0 / 16, 2.0 / 16, 1.0 / 16,
 				2.0 / 16, 4.0 / 16, 2.0 / 16,
 				1.0 / 16, 2.0 / 16, 1.0 / 16  
-				);
-			}
-
-			else if(edgeDetection == 1){
-			kernel = float[](
+			);
+#elif defined(KERNEL_EDGE_DETECTION)
+			const float kernel[9] = float[](
 				1, 1, 1,
 				1,  -8, 1,
 				1, 1, 1
 			);
-			}
+#else
+			const float kernel[9] = float[]( //default kernel
+				1, 1, 1,
+				1, 1, 1,
+				1, 1, 1
+			);
+#endif
 			vec3 sampleTex[9];
 			for(int i = 0; i < 9; i++)
 			{
@@ -80,11 +76,9 @@ void main()
 				col += sampleTex[i] * kernel[i];
     
 			FragColor = vec4(col, 1.0);
-		}
-
-		else{
+#else
 		//default pov without effect
 		FragColor = texture(screenTexture, TexCoords);
-		}
+#endif
 	}
 }
\ No newline at end of file
@@ -0,0 +1,43 @@
+#version 330 core
+//frustum culling and level of detail of one instance (see InstanceCuller), nothing is rasterized: instanceCull.geom keeps
+//the visible instances of one level and transform feedback writes them in the instance buffer of the draws
+layout (location = 0) in vec4 aInstancePositionScale; //see common/instanceTransform.glsl
+layout (location = 1) in vec4 aInstanceRotation;
+
+uniform vec4 frustumPlanes[6]; //world space, normals pointing inside
+uniform vec3 boundsCenter; //bounding sphere of the model (model space)
+uniform float boundsRadius;
+uniform vec3 viewPos;
+uniform float pixelScale; //projection[1][1] * viewport height / 2: pixels per unit at a distance of 1
+uniform float lodErrors[4]; //error of each level (model space), see Model::selectLod
+uniform int lodCount;
+uniform float maxPixelError;
+
+out vec4 vInstancePositionScale;
+out vec4 vInstanceRotation;
+flat out int vLod; //-1 outside the frustum
+
+#include "common/instanceTransform.glsl"
+
+void main()
+{
+	vInstancePositionScale = aInstancePositionScale;
+	vInstanceRotation = aInstanceRotation;
+	float scale = aInstancePositionScale.w;
+	vec3 center = instanceTransform(boundsCenter, aInstancePositionScale, aInstanceRotation);
+	float radius = boundsRadius * scale;
+
+	vLod = 0;
+	for (int i = 0; i < 6; i++)
+		if (dot(frustumPlanes[i].xyz, center) + frustumPlanes[i].w < -radius)
+			vLod = -1;
+	if (vLod == 0) {
+		float distance = length(center - viewPos) - radius;
+		if (distance > 0.0) { //otherwise the camera is inside the bounding sphere, full level
+			float pixelsPerUnit = scale * pixelScale / distance;
+			while (vLod + 1 < lodCount && lodErrors[vLod + 1] * pixelsPerUnit <= maxPixelError)
+				vLod++;
+		}
+	}
+	gl_Position = vec4(0.0, 0.0, 0.0, 1.0);
+}
\ No newline at end of file
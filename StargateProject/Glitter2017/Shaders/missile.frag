@@ -9,26 +9,6 @@ struct Material {
 	vec3 specular;
 };
 
-struct Light {
-    vec4 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-	
-	//case of spotlight
-	int spotlight;
-	vec3 direction;
-    float innerCutOff;
-	float outerCutOff;
-
-	//light attenuation for point lights  and spotlights using quadratic reduction
-	int attenuationBool;
-	float constant; 
-    float linear;
-    float quadratic;
-};
-
-#define NR_POINT_LIGHTS 10 //for optimization purposes, I only render the 10 closest light sources
 in VS_OUT {
 	vec2 TexCoords;
 	vec3 FragPos;
@@ -36,27 +16,14 @@ in VS_OUT {
 } fs_in;
 
 
-uniform vec3 viewPos;
+#include "common/frameData.glsl"
+#include "common/lights.glsl"
+#include "common/shadows.glsl"
 uniform Material material;
-uniform Light light[NR_POINT_LIGHTS]; 
-uniform int lightCounter;
 
-//shadows
-uniform float far_plane;
-uniform samplerCube depthMap;
-// array of offset direction for sampling
-vec3 gridSamplingDisk[20] = vec3[]
-(
-   vec3(1, 1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1, 1,  1), 
-   vec3(1, 1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1, 1, -1),
-   vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
-   vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
-   vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
-);
 
 
-vec3 calcFragFromALightSource(Light light, vec3 norm, vec3 FragPos, vec3 viewDir, vec3 viewPos, bool sunlight);
-float shadowCalculation(vec3 fragPos, vec3 lightPos, vec3 viewPos);
+vec3 calcFragFromALightSource(Light light, vec3 norm, vec3 FragPos, vec3 viewDir, float shadow);
 
 void main()
 {//Using a function to calculate the lighting for each light source
@@ -66,84 +33,25 @@ void main()
 	vec3 ViewDirEnvMapping = normalize(fs_in.FragPos - viewPos);
 	vec3 result = vec3(0.0f, 0.0f, 0.0f); //default
     
-	for (int i = 0; i < min(NR_POINT_LIGHTS, lightCounter); i++){
-		result += calcFragFromALightSource(light[i], norm, fs_in.FragPos, viewDir, viewPos, i==3);    
+	LightList lights = lightList(fs_in.FragPos);
+	for (int i = 0; i < lights.count; i++){
+		int index = lightIndex(lights, i);
+		Light source = getLight(index);
+		result += calcFragFromALightSource(source, norm, fs_in.FragPos, viewDir, calcSunShadow(fs_in.FragPos, lights, index, source));
     }
 
     FragColor = vec4(result, 1.0);
 }
 
 
-vec3 calcFragFromALightSource(Light light, vec3 norm, vec3 FragPos, vec3 viewDir, vec3 viewPos, bool sunlight){
-//attenuation
-	float attenuation = 1; //default value
-	if(light.attenuationBool == 1){
-		float distance = length(light.position.xyz - FragPos);
-		attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-	}
+vec3 calcFragFromALightSource(Light light, vec3 norm, vec3 FragPos, vec3 viewDir, float shadow){
 	//////////////////////////////PHONGS SHADING////////////////////////////////
+	LightTerms terms = calcLightTerms(light, norm, FragPos, viewDir, material.shininess);
+	vec3 albedo = vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
+	vec3 ambient = terms.ambient * albedo;
+	vec3 diffuse = light.diffuse * terms.diffuse * albedo;
+	vec3 specular = light.specular * terms.specular;
 
-	// ambient
-	vec3 ambient = vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-
-	// diffuse 
-	vec3 lightDir = vec3(0.0f,0.0f,0.0f); //default value
-	
-	if(light.position.w == 1.0f){ //if light is a point light
-		lightDir = normalize(light.position.xyz - FragPos);
-	}
-	else if(light.position.w == 0.0f){ //if light is directional (no impact from translations)
-		lightDir = normalize(-light.position.xyz);
-	}
-	float diff = max(dot(norm, lightDir), 0.0);
-	vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-    
-
-	// specular
-	vec3 halfwayDir = normalize(lightDir + viewDir); //used for Blinn-Phong's shading algorithm to overcome issues with high shininess
-	float spec = pow(max(dot(norm, halfwayDir), 0.0), material.shininess); 
-	vec3 specular = light.specular * spec;
-        
-
-	//case of a spotlight
-	if(light.spotlight == 1){ 
-		float theta = dot(lightDir, normalize(-light.direction)); //cosine of angle between fragment and spot direction
-		float intensity = smoothstep(light.outerCutOff, light.innerCutOff, theta);//progressive dark when out of inner cutoff angle cosine
-		diffuse *= intensity;
-		specular *= intensity;
-		ambient *= intensity; //remove intensity for ambient so that inside is always lighter than outside spotlight cone
-		}
-
-	//shadows
-	float shadow = 0.0f;
-	if(sunlight){ //only for the sunlight
-		shadow = shadowCalculation(fs_in.FragPos, vec3(light.position), viewPos); //equals 0 when frag not in shadow and 1 when in shadows, with soft shadows from PCF algo
-	}
-	else{
-		shadow = 0.0f;
-	}
 	////////////////////////////RESULT////////////////////////////////////
-	vec3 result = (ambient*0.1f + (1.0f - shadow) * (diffuse *0.8f + specular*1.2f)) * attenuation;
-	return result;
-}
-
-float shadowCalculation(vec3 fragPos, vec3 lightPos, vec3 viewPos)
-{    
-	vec3 fragToLight = fragPos - lightPos;
-    float currentDepth = length(fragToLight);
-    float shadow = 0.0;
-    float bias = 4.0;
-    int samples = 20;
-    float viewDistance = length(viewPos - fragPos);
-    float diskRadius = (1.0 + (viewDistance / far_plane)) / 3.0;
-    for(int i = 0; i < samples; ++i)
-    {
-        float closestDepth = texture(depthMap, fragToLight + gridSamplingDisk[i] * diskRadius).r;
-        closestDepth *= far_plane; 
-        if(currentDepth - bias > closestDepth)
-            shadow += 1.0;
-    }
-    shadow /= float(samples);
-        
-    return shadow;
-} 
\ No newline at end of file
+	return ambient*0.1f + (1.0f - shadow) * (diffuse *0.8f + specular*1.2f);
+}
\ No newline at end of file
@@ -10,8 +10,7 @@ out VS_OUT {
 } vs_out;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/frameData.glsl"
 
 void main()
 {
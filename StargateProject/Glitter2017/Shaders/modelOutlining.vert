@@ -3,8 +3,7 @@ layout (location = 0) in vec3 aPos;
 
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/frameData.glsl"
 
 void main()
 { 
@@ -3,8 +3,7 @@ layout (location = 0) in vec3 aPos;
 
 out vec4 ParticleColor;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "common/frameData.glsl"
 uniform vec3 offset;
 uniform vec4 color;
 
@@ -1,4 +1,6 @@
 #version 330 core
+//features, defined by Shader::variant: REFLECTION (skybox reflection added to the lighting), REFRACTION (skybox refraction
+//with material.refractionRatio, replaces the lighting)
 out vec4 FragColor;
 
 struct Material {
@@ -8,30 +10,9 @@ struct Material {
 	vec3 diffuse;
 	vec3 specular;
 
-	int reflection;
 	float refractionRatio;
 };
 
-struct Light {
-    vec4 position;
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-	
-	//case of spotlight
-	int spotlight;
-	vec3 direction;
-    float innerCutOff;
-	float outerCutOff;
-
-	//light attenuation for point lights  and spotlights using quadratic reduction
-	int attenuationBool;
-	float constant; 
-    float linear;
-    float quadratic;
-};
-
-#define NR_POINT_LIGHTS 10 //for optimization purposes, I only render the 10 closest light sources
 in VS_OUT {
 	vec2 TexCoords;
 	vec3 FragPos;
@@ -39,30 +20,17 @@ in VS_OUT {
 } fs_in;
 
 
-uniform vec3 viewPos;
+#include "common/frameData.glsl"
+#include "common/lights.glsl"
+#include "common/shadows.glsl"
 uniform Material material;
-uniform Light light[NR_POINT_LIGHTS]; 
-uniform int lightCounter;
-
-//shadows
-uniform float far_plane;
-uniform samplerCube depthMap;
-// array of offset direction for sampling
-vec3 gridSamplingDisk[20] = vec3[]
-(
-   vec3(1, 1,  1), vec3( 1, -1,  1), vec3(-1, -1,  1), vec3(-1, 1,  1), 
-   vec3(1, 1, -1), vec3( 1, -1, -1), vec3(-1, -1, -1), vec3(-1, 1, -1),
-   vec3(1, 1,  0), vec3( 1, -1,  0), vec3(-1, -1,  0), vec3(-1, 1,  0),
-   vec3(1, 0,  1), vec3(-1,  0,  1), vec3( 1,  0, -1), vec3(-1, 0, -1),
-   vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
-);
+
 
 uniform samplerCube skybox; //for refraction
 
 vec3 calcRefraction(vec3 normal, vec3 viewDir, float refractionRatio);
 vec3 calcReflection(vec3 normal, vec3 viewDir);
-vec3 calcFragFromALightSource(Light light, vec3 norm, vec3 FragPos, vec3 viewDir, vec3 viewPos, bool sunlight);
-float shadowCalculation(vec3 fragPos, vec3 lightPos, vec3 viewPos);
+vec3 calcFragFromALightSource(Light light, vec3 norm, vec3 FragPos, vec3 viewDir, float shadow);
 
 
 
@@ -74,110 +42,46 @@ void main()
 	vec3 ViewDirEnvMapping = normalize(fs_in.FragPos - viewPos);
 	vec3 result = vec3(0.0f, 0.0f, 0.0f); //default
     
-	for (int i = 0; i < min(NR_POINT_LIGHTS, lightCounter); i++){
-		result += calcFragFromALightSource(light[i], norm, fs_in.FragPos, viewDir, viewPos, i == 3);    
+	LightList lights = lightList(fs_in.FragPos);
+	for (int i = 0; i < lights.count; i++){
+		int index = lightIndex(lights, i);
+		Light source = getLight(index);
+		result += calcFragFromALightSource(source, norm, fs_in.FragPos, viewDir, calcSunShadow(fs_in.FragPos, lights, index, source));
     }
 
 	//environment mapping
+#ifdef REFLECTION
 	result += calcReflection(norm, ViewDirEnvMapping) *2.5f; //used only if triggered for demo purpose
-	if(material.refractionRatio != 0.0)
-		result = calcRefraction(norm, ViewDirEnvMapping, material.refractionRatio);  //used only if triggered for demo purpose, only refraction
+#endif
+#ifdef REFRACTION
+	result = calcRefraction(norm, ViewDirEnvMapping, material.refractionRatio);  //used only if triggered for demo purpose, only refraction
+#endif
     FragColor = vec4(result, 1.0);
 	//FragColor = vec4(test,1.0f); debug purpose
 }
 
 
-vec3 calcFragFromALightSource(Light light, vec3 norm, vec3 FragPos, vec3 viewDir, vec3 viewPos, bool sunlight){
-//attenuation
-	float attenuation = 1; //default value
-	if(light.attenuationBool == 1){
-		float distance = length(light.position.xyz - FragPos);
-		attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
-	}
+vec3 calcFragFromALightSource(Light light, vec3 norm, vec3 FragPos, vec3 viewDir, float shadow){
 	//////////////////////////////PHONGS SHADING////////////////////////////////
+	LightTerms terms = calcLightTerms(light, norm, FragPos, viewDir, material.shininess);
+	vec3 albedo = vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
+	vec3 ambient = terms.ambient * albedo;
+	vec3 diffuse = light.diffuse * terms.diffuse * albedo;
+	vec3 specular = light.specular * terms.specular;
 
-	// ambient
-	vec3 ambient = vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-
-	// diffuse 
-	vec3 lightDir = vec3(0.0f,0.0f,0.0f); //default value
-	
-	if(light.position.w == 1.0f){ //if light is a point light
-		lightDir = normalize(light.position.xyz - FragPos);
-	}
-	else if(light.position.w == 0.0f){ //if light is directional (no impact from translations)
-		lightDir = normalize(-light.position.xyz);
-	}
-	float diff = max(dot(norm, lightDir), 0.0);
-	vec3 diffuse = light.diffuse * diff * vec3(texture(material.texture_diffuse1, fs_in.TexCoords));
-    
-
-	// specular
-	vec3 halfwayDir = normalize(lightDir + viewDir); //used for Blinn-Phong's shading algorithm to overcome issues with high shininess
-	float spec = pow(max(dot(norm, halfwayDir), 0.0), material.shininess); 
-	vec3 specular = light.specular * spec;
-        
-
-	//case of a spotlight
-	if(light.spotlight == 1){ 
-		float theta = dot(lightDir, normalize(-light.direction)); //cosine of angle between fragment and spot direction
-		float intensity = smoothstep(light.outerCutOff, light.innerCutOff, theta);//progressive dark when out of inner cutoff angle cosine
-		diffuse *= intensity;
-		specular *= intensity;
-		ambient *= intensity; //remove intensity for ambient so that inside is always lighter than outside spotlight cone
-		}
-
-	//shadows
-	float shadow = 0.0f;
-	if(sunlight){ //only for the sunlight
-		shadow = shadowCalculation(fs_in.FragPos, vec3(light.position), viewPos); //equals 0 when frag not in shadow and 1 when in shadows, with soft shadows from PCF algo
-	}
-	else{
-		shadow = 0.0f;
-	}
 	////////////////////////////RESULT////////////////////////////////////
-	vec3 result = (ambient*0.2f + (1.0f - shadow) * (diffuse *1.8 + specular*0.8)) * attenuation;
-	return result;
+	return ambient*0.2f + (1.0f - shadow) * (diffuse*1.8 + specular*0.8);
 }
 
 
 vec3 calcReflection(vec3 normal, vec3 viewDir){
-	//refraction
-	vec3 reflection = vec3(0.0f);
-	if(material.reflection == 1){
+	//reflection
 	vec3 R = reflect(viewDir, normal); //using OpenGL built-in function, algebra is similar to specular light
-	reflection = vec3(texture(skybox, R).rgb);
-	}
-	return reflection;
+	return vec3(texture(skybox, R).rgb);
 }
 
 vec3 calcRefraction(vec3 normal, vec3 viewDir, float refractionRatio){
 	//refraction
-	vec3 refraction = vec3(0.0f);
-	if(material.refractionRatio != 0.0f){
 	vec3 R = refract(viewDir, normal, refractionRatio); //using built-in fct
-	refraction = vec3(texture(skybox, R).rgb);
-	}
-	return refraction;
-}
-
-float shadowCalculation(vec3 fragPos, vec3 lightPos, vec3 viewPos)
-{    
-	vec3 fragToLight = fragPos - lightPos;
-    float currentDepth = length(fragToLight);
-    float shadow = 0.0;
-    float bias = 4.0;
-    int samples = 20;
-    float viewDistance = length(viewPos - fragPos);
-    float diskRadius = (1.0 + (viewDistance / far_plane)) / 3.0;
-    for(int i = 0; i < samples; ++i)
-    {
-        float closestDepth = texture(depthMap, fragToLight + gridSamplingDisk[i] * diskRadius).r;
-        closestDepth *= far_plane; 
-        if(currentDepth - bias > closestDepth)
-            shadow += 1.0;
-    }
-    shadow /= float(samples);
-        
-    return shadow;
-} 
\ No newline at end of file
+	return vec3(texture(skybox, R).rgb);
+}
\ No newline at end of file
@@ -1,5 +1,5 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+layout (location = 0) in vec4 aPos; //w is 1 with the float format
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 
@@ -10,13 +10,25 @@ out VS_OUT {
 } vs_out;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/frameData.glsl"
+#include "common/vertexFormat.glsl"
+
+vec3 vertexPosition()
+{
+	return decodePosition(aPos);
+}
+
+vec3 vertexNormal()
+{
+	return decodeNormal(aNormal);
+}
 
 void main()
 {
-    vs_out.FragPos = vec3(model * vec4(aPos, 1.0));
-	vs_out.Normal = transpose(inverse(mat3(model))) * aNormal;
+	vec3 position = vertexPosition();
+	vec3 normal = vertexNormal();
+    vs_out.FragPos = vec3(model * vec4(position, 1.0));
+	vs_out.Normal = transpose(inverse(mat3(model))) * normal;
 	vs_out.TexCoords = aTexCoords;
     gl_Position = projection * view * vec4(vs_out.FragPos, 1.0);
 }
\ No newline at end of file
@@ -1,10 +1,32 @@
 #version 330 core
-layout (location = 0) in vec3 aPos;
+//depth of one face of the shadow cubemap, the casters are culled and drawn face by face (see ShadowCache)
+//INSTANCED: the asteroids, transformed by their instance transform instead of model
+layout (location = 0) in vec4 aPos; //w is 1 with the float format
+#ifdef INSTANCED
+layout (location = 3) in vec4 aInstancePositionScale; //see common/instanceTransform.glsl
+layout (location = 4) in vec4 aInstanceRotation;
+#endif
 
 uniform mat4 model;
+uniform mat4 shadowMatrix; //light space transform of the face being rendered
+
+out vec4 FragPos;
+
+#include "common/vertexFormat.glsl"
+#include "common/instanceTransform.glsl"
+
+vec3 vertexPosition()
+{
+	return decodePosition(aPos);
+}
 
 void main()
 {
-	//only transforms vertices coord to world space coord and send it to geometry shader
-    gl_Position = model * vec4(aPos, 1.0);
-}  
\ No newline at end of file
+	//world space position for the distance to the light in the fragment shader
+#ifdef INSTANCED
+	FragPos = vec4(instanceTransform(vertexPosition(), aInstancePositionScale, aInstanceRotation), 1.0);
+#else
+	FragPos = model * vec4(vertexPosition(), 1.0);
+#endif
+	gl_Position = shadowMatrix * FragPos;
+}
\ No newline at end of file
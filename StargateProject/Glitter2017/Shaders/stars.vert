@@ -4,8 +4,7 @@ layout(location = 0 ) in vec3 position;
 layout(location = 1) in vec4 starInfo;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/frameData.glsl"
 
 void main(){
 gl_Position = projection * view * model * vec4(position + starInfo.xyz, 1.0f);
@@ -6,8 +6,7 @@ out vec2 TexCoords;
 out vec2 viewportPixelCoord;
 out vec2 PosViewportPixelCoord;
 
-uniform mat4 projection;
-uniform mat4 view;
+#include "common/frameData.glsl"
 uniform mat4 model;
 uniform vec3 stargatePos;
 
@@ -13,11 +13,9 @@ out VS_OUT {
 } vs_out;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "common/frameData.glsl"
 
 uniform vec3 lightPos;
-uniform vec3 viewPos;
 
 void main()
 {
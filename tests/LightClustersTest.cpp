@@ -0,0 +1,111 @@
+// Standalone check of the light binning of LightClusters, outside of the application build (no GL context needed):
+//	g++ -std=c++14 -I../vendors/includes -I../Sources LightClustersTest.cpp ../Sources/LightClusters.cpp ../Sources/glad.c -o LightClustersTest
+// Returns 0 when every check passes, prints the failures otherwise
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "LightClusters.hpp"
+#include "LightSource.h"
+
+static int failures = 0;
+
+static void check(bool condition, const std::string& message) {
+	if (!condition) {
+		failures++;
+		std::cout << "FAILED: " << message << std::endl;
+	}
+}
+
+static bool contains(const std::vector<int>& lights, int light) {
+	for (int l : lights)
+		if (l == light)
+			return true;
+	return false;
+}
+
+//point light at position, without GL resources (non zero VAO)
+static LightSource* pointLight(const glm::vec3& position) {
+	static int lightCounter = 0;
+	return new LightSource(&lightCounter, POINTLIGHT, position, glm::vec3(1.0f), 1.0f, 0.09f, 0.032f, 1.0f, 1);
+}
+
+// every point inside the sphere of a light falls in a cluster whose list holds the light
+static void checkAssignment(const glm::mat4& projection, const char* name) {
+	std::mt19937 random(2017);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	const glm::mat4 view = glm::lookAt(glm::vec3(5.0f, 3.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	const glm::mat4 inverseView = glm::inverse(view);
+
+	//under the cap of a cluster, so that no list is cut
+	std::vector<LightSource*> lights;
+	std::vector<float> radii;
+	for (int i = 0; i < 40; i++) {
+		const glm::vec3 viewPosition(unit(random) * 40.0f, unit(random) * 25.0f, -2.0f - (unit(random) + 1.0f) * 60.0f);
+		lights.push_back(pointLight(glm::vec3(inverseView * glm::vec4(viewPosition, 1.0f))));
+		radii.push_back(0.5f + (unit(random) + 1.0f) * 10.0f);
+	}
+	LightClusters clusters;
+	clusters.build(lights, radii, view, projection);
+
+	std::vector<int> list;
+	int sampled = 0;
+	for (unsigned int i = 0; i < lights.size(); i++) {
+		for (int sample = 0; sample < 200; sample++) {
+			glm::vec3 offset(unit(random), unit(random), unit(random));
+			if (glm::length(offset) > 1.0f)
+				continue;
+			const glm::vec4 viewPoint = view * glm::vec4(glm::vec3(lights[i]->Position) + offset * radii[i], 1.0f);
+			const glm::vec4 clip = projection * viewPoint;
+			if (clip.w <= 0.0f)
+				continue;
+			const int cluster = clusters.clusterIndex(glm::vec2(clip) / clip.w, -viewPoint.z);
+			if (cluster < 0) //outside of the frustum
+				continue;
+			sampled++;
+			clusters.lightsOf(cluster, list);
+			check(contains(list, (int)i), std::string(name) + ": light " + std::to_string(i) + " missing from cluster " + std::to_string(cluster));
+		}
+	}
+	check(sampled > 0, std::string(name) + ": no sample inside the frustum");
+	for (LightSource* light : lights)
+		delete light;
+}
+
+// a cluster reached by more lights than the cap keeps the first maxLightsPerCluster ones, in the order of the light list
+static void checkCap(const glm::mat4& projection) {
+	const glm::mat4 view = glm::mat4(1.0f);
+	std::vector<LightSource*> lights;
+	std::vector<float> radii;
+	for (int i = 0; i < 100; i++) {
+		lights.push_back(pointLight(glm::vec3(0.0f, 0.0f, -20.0f)));
+		radii.push_back(5.0f);
+	}
+	LightClusters clusters;
+	clusters.build(lights, radii, view, projection);
+
+	std::vector<int> list;
+	clusters.lightsOf(clusters.clusterIndex(glm::vec2(0.0f), 20.0f), list);
+	check((int)list.size() == LightClusters::maxLightsPerCluster, "cap: " + std::to_string(list.size()) + " lights in the cluster");
+	for (unsigned int i = 0; i < list.size(); i++)
+		check(list[i] == (int)i, "cap: light " + std::to_string(list[i]) + " at " + std::to_string(i));
+	for (LightSource* light : lights)
+		delete light;
+}
+
+int main() {
+	const float aspect = 1690.0f / 1050.0f;
+	//the application flips the image with a negative fovy, the binning must hold for both
+	const glm::mat4 projection = glm::perspective(glm::radians(40.0f), aspect, 0.1f, 1000.0f);
+	const glm::mat4 flippedProjection = glm::perspective(glm::radians(-40.0f), aspect, 0.1f, 1000.0f);
+	checkAssignment(projection, "assignment");
+	checkAssignment(flippedProjection, "assignment (negative fovy)");
+	checkCap(projection);
+
+	std::cout << (failures == 0 ? "LightClusters: all checks passed" : "LightClusters: " + std::to_string(failures) + " failures") << std::endl;
+	return failures == 0 ? 0 : 1;
+}